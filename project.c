@@ -1,9 +1,37 @@
 
+#define _GNU_SOURCE // SCHED_BATCH for background threads
 #include <stdint.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <stdbool.h>
+#include <math.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#ifdef _WIN32
+#include <conio.h>  // term HAL: console keyboard (no poll() on stdin)
+#include <malloc.h> // _aligned_malloc (UCRT has no aligned_alloc)
+#else
+#include <poll.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "reflex.h"
+#ifdef __linux__
+#include <sys/mman.h> // mlockall for the WCET harness
+#endif
+#if defined(REFLEX_PROF_PERF) && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 /* =========================
    System Parameters (tune later)
@@ -14,6 +42,23 @@
 #define TACTILE_WINDOW_MS 1500  // PI3: time allowed for tactile after visual
 #define PRESSURE_THRESHOLD 400  // PI3: mock ADC threshold (0..1023)
 #define UART_BAUD 115200        // PI3
+#define STATION_ID 1            // PI3: station number carried in every UART frame
+#ifndef VIS_FILTER_N
+#define VIS_FILTER_N 4            // PI2 glitch filter: vote over the last N samples (≤ 32)
+#endif
+#ifndef VIS_FILTER_K
+#define VIS_FILTER_K 3            // PI2 glitch filter: ≥ K of them high
+#endif
+#ifndef VIS_FILTER_MIN_WIDTH_MS
+#define VIS_FILTER_MIN_WIDTH_MS 2 // PI2 glitch filter: and high for ≥ this many consecutive ms
+#endif
+#define ROUND_REC_POOL_SIZE 64            // in-flight round records (< 0xFFFF)
+#ifndef HISTORY_CAPACITY
+#define HISTORY_CAPACITY (1u << 20) // packed rounds kept in memory (8 B each; 100M ≈ 800 MB)
+#endif
+#ifndef PLAYER_STORE_CAPACITY
+#define PLAYER_STORE_CAPACITY (1u << 20) // mock persistent player store (16 B per profile)
+#endif
 
 /* =========================
    Global State (mocked)
@@ -31,18 +76,55 @@ typedef enum
     ST_FEEDBACK
 } sys_state_t;
 
-static sys_state_t g_state = ST_IDLE;
-static uint32_t g_random_wait_ms = 0;         // PI1
-static uint32_t g_visual_ms = 0;              // PI2
-static uint32_t g_tactile_ms = 0;             // PI3
-static uint32_t g_best_total_ms = 0xFFFFFFFF; // PI3
-static uint32_t g_round_ix = 0;               // for mock sequence
-static uint32_t g_time = 0;                   // mock time tracker
-static bool g_score_improved = false;         // track if best score improved this round
+typedef enum
+{
+    ABORT_NONE = 0,
+    ABORT_FALSE_START,   // hand seen during foreperiod
+    ABORT_VIS_TIMEOUT,   // no hand within VISUAL_WINDOW_MS
+    ABORT_TACT_TIMEOUT   // no press within TACTILE_WINDOW_MS
+} abort_cause_t;
+
+static const char *const abort_cause_names[] = {"-", "false-start", "vis-timeout", "tact-timeout"};
+
+// Round engine state is per thread: batch simulation runs one engine per worker
+static __thread sys_state_t g_state = ST_IDLE;
+static __thread uint32_t g_random_wait_ms = 0;         // PI1
+static __thread uint32_t g_visual_ms = 0;              // PI2
+static __thread uint32_t g_tactile_ms = 0;             // PI3
+static __thread uint32_t g_best_total_ms = 0xFFFFFFFF; // PI3
+static __thread uint32_t g_round_ix = 0;               // for mock sequence
+static __thread uint32_t g_time = 0;                   // mock time tracker
+static __thread uint32_t g_round_elapsed_ms = 0;       // mock ms from ARMED to REPORT/ABORT of last round
+static __thread uint32_t g_player_id = 0;              // active player (0 = anonymous)
+static __thread uint16_t g_pressure_threshold = PRESSURE_THRESHOLD; // PI3: active (per-player calibrated)
+static __thread bool g_score_improved = false;         // track if best score improved this round
+#ifdef REFLEX_LIB
+static bool g_quiet = true; // library build: the engine never prints
+#else
+static bool g_quiet = false;                           // suppress mock console output (WCET/bench runs)
+#endif
+
+#define LOG(...)                 \
+    do                           \
+    {                            \
+        if (!g_quiet)            \
+            printf(__VA_ARGS__); \
+    } while (0)
 
 /* =========================
    Utilities (purely mock)
    ========================= */
+static __thread uint32_t t_rng = 0; // per-thread xorshift32 state; 0 → libc rand()
+
+// Mock randomness: libc rand() (srand-reproducible) unless the thread seeded its own stream
+static inline uint32_t mock_rand(void)
+{
+    if (!t_rng)
+        return (uint32_t)rand();
+    t_rng ^= t_rng << 13, t_rng ^= t_rng >> 17, t_rng ^= t_rng << 5;
+    return t_rng;
+}
+
 static uint32_t clamp(uint32_t v, uint32_t lo, uint32_t hi)
 {
     if (v < lo)
@@ -52,6 +134,498 @@ static uint32_t clamp(uint32_t v, uint32_t lo, uint32_t hi)
     return v;
 }
 
+// Free-running cycle counter (TSC on x86, monotonic ns elsewhere)
+static inline uint64_t cycles_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#else
+    return (uint64_t)clock();
+#endif
+}
+
+// Monotonic wall time in seconds (multi-threaded benchmarks)
+static double wall_now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// cycles_now() ticks per nanosecond, calibrated once against the wall clock
+static double cycles_per_ns(void)
+{
+    static double cpn = 0.0;
+    if (cpn == 0.0)
+    {
+        double t0 = wall_now_s();
+        uint64_t c0 = cycles_now();
+        while (wall_now_s() - t0 < 0.02)
+            ;
+        cpn = (double)(cycles_now() - c0) / ((wall_now_s() - t0) * 1e9);
+    }
+    return cpn;
+}
+
+/* =========================
+   Hot-path instrumentation (build with -DREFLEX_PROF)
+   ========================= */
+
+// Call-sites bracketed by PROF_BEGIN/PROF_END (cycles are inclusive of nested sites)
+typedef enum
+{
+    PROF_SENSOR_READ = 0, // visual line sample / pressure ADC read
+    PROF_THRESHOLD,       // tactile threshold compare
+    PROF_DISPATCH,        // state step dispatch in run_one_round()
+    PROF_FORMAT,          // UART frame formatting
+    PROF_COUNT
+} prof_site_t;
+
+typedef struct
+{
+    uint64_t calls;
+    uint64_t cycles;
+    uint64_t cache_miss; // REFLEX_PROF_PERF only
+    uint64_t br_miss;    // REFLEX_PROF_PERF only
+} prof_counter_t;
+
+typedef struct
+{
+    uint64_t cyc;
+    uint64_t cache_miss;
+    uint64_t br_miss;
+} prof_mark_t;
+
+static __thread prof_counter_t g_prof[PROF_COUNT];
+
+#if defined(REFLEX_PROF_PERF) && defined(__linux__)
+static __thread int g_perf_fd = -1;    // group leader: cache misses
+static __thread int g_perf_br_fd = -1; // group member: branch mispredictions
+static __thread volatile struct perf_event_mmap_page *g_perf_pg[2]; // user pages for rdpmc (NULL: not usable)
+
+static int perf_open(uint32_t type, uint64_t config, int group_fd)
+{
+    struct perf_event_attr pe;
+    memset(&pe, 0, sizeof(pe));
+    pe.size = sizeof(pe);
+    pe.type = type;
+    pe.config = config;
+    pe.disabled = (group_fd == -1);
+    pe.exclude_kernel = 1;
+    pe.exclude_hv = 1;
+    pe.read_format = PERF_FORMAT_GROUP;
+    return (int)syscall(__NR_perf_event_open, &pe, 0, -1, group_fd, 0);
+}
+
+// Map the counter's user page; NULL unless the kernel allows rdpmc from user space
+static volatile struct perf_event_mmap_page *perf_map(int fd)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    size_t len = (size_t)sysconf(_SC_PAGESIZE);
+    void *p = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+        return NULL;
+    volatile struct perf_event_mmap_page *pg = (volatile struct perf_event_mmap_page *)p;
+    if (pg->cap_user_rdpmc)
+        return pg;
+    munmap(p, len);
+#else
+    (void)fd;
+#endif
+    return NULL;
+}
+
+// Open per-thread hardware counters; NULL if the kernel refuses (counters stay 0), else the read path
+static const char *prof_perf_init(void)
+{
+    g_perf_fd = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, -1);
+    if (g_perf_fd < 0)
+        return NULL;
+    g_perf_br_fd = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, g_perf_fd);
+    if (g_perf_br_fd < 0)
+    {
+        close(g_perf_fd);
+        g_perf_fd = -1;
+        return NULL;
+    }
+    ioctl(g_perf_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(g_perf_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    g_perf_pg[0] = perf_map(g_perf_fd);
+    g_perf_pg[1] = g_perf_pg[0] ? perf_map(g_perf_br_fd) : NULL;
+    if (g_perf_pg[0] && !g_perf_pg[1])
+        g_perf_pg[0] = NULL; // both or neither (the page stays mapped; this runs once per thread)
+    return g_perf_pg[0] ? "rdpmc at every site" : "read() at dispatch sites only";
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Self-monitoring counter read: seqlock over the user page + rdpmc, no syscall
+static inline uint64_t perf_rdpmc(volatile struct perf_event_mmap_page *pg)
+{
+    uint32_t seq;
+    uint64_t count;
+    do
+    {
+        seq = pg->lock;
+        atomic_signal_fence(memory_order_acquire);
+        count = pg->offset;
+        uint32_t idx = pg->index; // 0: counter not on a PMC right now
+        if (idx)
+        {
+            uint32_t shift = 64u - pg->pmc_width;
+            count += (uint64_t)((int64_t)((uint64_t)__rdpmc((int)(idx - 1)) << shift) >> shift);
+        }
+        atomic_signal_fence(memory_order_acquire);
+    } while (pg->lock != seq);
+    return count;
+}
+#endif
+
+static inline void prof_perf_read(prof_mark_t *m, prof_site_t site)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (g_perf_pg[0])
+    {
+        m->cache_miss = perf_rdpmc(g_perf_pg[0]);
+        m->br_miss = perf_rdpmc(g_perf_pg[1]);
+        return;
+    }
+#endif
+    // without rdpmc a read() costs a syscall: only whole state steps pay it, never per-ms samples
+    uint64_t buf[3] = {0, 0, 0}; // nr, cache misses, branch misses
+    if (site == PROF_DISPATCH && g_perf_fd >= 0 && read(g_perf_fd, buf, sizeof(buf)) == (ssize_t)sizeof(buf))
+    {
+        m->cache_miss = buf[1];
+        m->br_miss = buf[2];
+    }
+}
+#else
+static const char *prof_perf_init(void) { return NULL; }
+static inline void prof_perf_read(prof_mark_t *m, prof_site_t site)
+{
+    (void)m;
+    (void)site;
+}
+#endif
+
+static inline prof_mark_t prof_begin(prof_site_t site)
+{
+    prof_mark_t m = {0, 0, 0};
+    prof_perf_read(&m, site);
+    m.cyc = cycles_now();
+    return m;
+}
+
+static inline void prof_end(prof_site_t site, const prof_mark_t *m)
+{
+    uint64_t cyc = cycles_now();
+    prof_mark_t e = {cyc, 0, 0};
+    prof_perf_read(&e, site);
+    prof_counter_t *c = &g_prof[site];
+    c->calls += 1;
+    c->cycles += e.cyc - m->cyc;
+    c->cache_miss += e.cache_miss - m->cache_miss;
+    c->br_miss += e.br_miss - m->br_miss;
+}
+
+#ifdef REFLEX_PROF
+#define PROF_BEGIN(site) prof_mark_t prof_mark_##site = prof_begin(site)
+#define PROF_END(site) prof_end(site, &prof_mark_##site)
+#else
+#define PROF_BEGIN(site) ((void)0)
+#define PROF_END(site) ((void)0)
+#endif
+
+// Print this thread's per-site counters
+void prof_dump(void)
+{
+#ifdef REFLEX_PROF
+    static const char *const prof_names[PROF_COUNT] = {"sensor_read", "threshold", "dispatch", "format"};
+    printf("%-12s %12s %14s %10s %12s %12s\n", "site", "calls", "cycles", "cyc/call", "cache_miss", "br_miss");
+    for (int i = 0; i < PROF_COUNT; ++i)
+    {
+        const prof_counter_t *c = &g_prof[i];
+        printf("%-12s %12llu %14llu %10.1f %12llu %12llu\n", prof_names[i],
+               (unsigned long long)c->calls, (unsigned long long)c->cycles,
+               c->calls ? (double)c->cycles / (double)c->calls : 0.0,
+               (unsigned long long)c->cache_miss, (unsigned long long)c->br_miss);
+    }
+#else
+    printf("(hot-path instrumentation disabled; build with -DREFLEX_PROF)\n");
+#endif
+}
+
+void prof_reset(void)
+{
+    memset(g_prof, 0, sizeof(g_prof));
+}
+
+/* =========================
+   Allocators (no malloc in steady state)
+   ========================= */
+
+// Bump arena over caller-provided storage; everything is released at once by arena_reset()
+typedef struct
+{
+    uint8_t *base;
+    size_t cap;
+    size_t used;
+    size_t high_water;
+} arena_t;
+
+// Returns NULL when the arena is exhausted (never falls back to malloc)
+void *arena_alloc(arena_t *a, size_t size, size_t align)
+{
+    size_t off = (a->used + (align - 1)) & ~(align - 1);
+    if (off > a->cap || size > a->cap - off)
+        return NULL;
+    a->used = off + size;
+    if (a->used > a->high_water)
+        a->high_water = a->used;
+    return a->base + off;
+}
+
+void arena_reset(arena_t *a)
+{
+    a->used = 0;
+}
+
+// Fixed-size block pool over caller-provided storage (intrusive free list)
+typedef struct pool_block
+{
+    struct pool_block *next;
+} pool_block_t;
+
+typedef struct
+{
+    uint8_t *base;
+    size_t block_size;
+    uint32_t nblocks;
+    uint32_t in_use;
+    pool_block_t *free;
+} pool_t;
+
+void pool_init(pool_t *p, void *buf, size_t block_size, uint32_t nblocks)
+{
+    p->base = (uint8_t *)buf;
+    p->block_size = block_size < sizeof(pool_block_t) ? sizeof(pool_block_t) : block_size;
+    p->nblocks = nblocks;
+    p->in_use = 0;
+    p->free = NULL;
+    for (uint32_t i = nblocks; i > 0; --i)
+    {
+        pool_block_t *b = (pool_block_t *)(p->base + (size_t)(i - 1) * p->block_size);
+        b->next = p->free;
+        p->free = b;
+    }
+}
+
+// Returns NULL when the pool is empty
+void *pool_alloc(pool_t *p)
+{
+    pool_block_t *b = p->free;
+    if (!b)
+        return NULL;
+    p->free = b->next;
+    p->in_use++;
+    return b;
+}
+
+void pool_free(pool_t *p, void *blk)
+{
+    pool_block_t *b = (pool_block_t *)blk;
+    b->next = p->free;
+    p->free = b;
+    p->in_use--;
+}
+
+/* =========================
+   Allocation guard (build with -DREFLEX_ALLOC_GUARD, glibc only)
+   ========================= */
+
+// Armed around steady-state rounds; any heap call while armed is a violation
+static volatile bool g_alloc_armed = false;
+static volatile uint32_t g_alloc_violations = 0;
+
+#if defined(REFLEX_ALLOC_GUARD) && defined(__GLIBC__)
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+extern void __libc_free(void *);
+
+void *malloc(size_t n)
+{
+    if (g_alloc_armed)
+        g_alloc_violations++;
+    return __libc_malloc(n);
+}
+void *calloc(size_t n, size_t sz)
+{
+    if (g_alloc_armed)
+        g_alloc_violations++;
+    return __libc_calloc(n, sz);
+}
+void *realloc(void *p, size_t n)
+{
+    if (g_alloc_armed)
+        g_alloc_violations++;
+    return __libc_realloc(p, n);
+}
+void free(void *p)
+{
+    if (g_alloc_armed && p)
+        g_alloc_violations++;
+    __libc_free(p);
+}
+#define ALLOC_GUARD_ACTIVE 1
+#else
+#define ALLOC_GUARD_ACTIVE 0
+#endif
+
+/* =========================
+   Round result records (lock-free fixed pool)
+   ========================= */
+
+// One cache line per round; consumers receive a handle, never a copy
+typedef struct
+{
+    _Alignas(64) uint32_t seq; // station-wide round sequence number
+    uint32_t round_ix;
+    uint32_t wait_ms;
+    uint32_t vis_ms;
+    uint32_t tact_ms;
+    uint32_t total_ms;
+    uint32_t best_ms;
+    uint32_t player; // 0 = anonymous single-player station
+    uint8_t state; // sys_state_t at publish time
+    uint8_t flags; // REC_F_*
+    uint8_t cause; // abort_cause_t (ABORT_NONE for completed rounds)
+    _Atomic uint16_t refcnt;
+    uint16_t next; // free-list link (valid only while free)
+} round_rec_t;
+
+_Static_assert(sizeof(round_rec_t) == 64, "round record must fill exactly one cache line");
+
+#define REC_F_BEST_IMPROVED 0x01u
+#define REC_F_DUEL_WIN 0x02u
+
+typedef uint16_t rec_handle_t;
+#define REC_NONE ((rec_handle_t)0xFFFF)
+
+#define REC_PRIVATE_MAX 16 // records in a thread-private pool (sim workers)
+
+static round_rec_t g_rec_pool[ROUND_REC_POOL_SIZE];
+// Treiber stack head: [31:16] ABA tag, [15:0] index (REC_NONE = empty)
+static _Atomic uint32_t g_rec_free_head = REC_NONE;
+static atomic_flag g_rec_pool_ready = ATOMIC_FLAG_INIT;
+static _Atomic uint64_t g_rec_exhausted; // rec_alloc() failures: those rounds were not published
+static __thread uint32_t g_round_seq = 0; // per round engine (one per thread in sim mode)
+// Thread-private pool (handles ROUND_REC_POOL_SIZE..): used instead of the shared pool when attached;
+// its handles are only valid on the owning thread, so every stage must run there
+static __thread round_rec_t *t_rec_private;
+static __thread rec_handle_t t_rec_private_free = REC_NONE;
+
+_Static_assert(ROUND_REC_POOL_SIZE + REC_PRIVATE_MAX < REC_NONE, "record handles must fit 16 bits");
+
+static void rec_push_free(rec_handle_t h)
+{
+    uint32_t old = atomic_load_explicit(&g_rec_free_head, memory_order_relaxed);
+    uint32_t nxt;
+    do
+    {
+        g_rec_pool[h].next = (uint16_t)(old & 0xFFFFu);
+        nxt = ((old + 0x10000u) & 0xFFFF0000u) | h;
+    } while (!atomic_compare_exchange_weak_explicit(&g_rec_free_head, &old, nxt,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+static void rec_pool_init(void)
+{
+    if (atomic_flag_test_and_set(&g_rec_pool_ready))
+        return;
+    for (uint32_t i = ROUND_REC_POOL_SIZE; i > 0; --i)
+        rec_push_free((rec_handle_t)(i - 1));
+}
+
+static inline round_rec_t *rec_get(rec_handle_t h)
+{
+    return h < ROUND_REC_POOL_SIZE ? &g_rec_pool[h] : &t_rec_private[h - ROUND_REC_POOL_SIZE];
+}
+
+// Attach n (≤ REC_PRIVATE_MAX) caller-owned records as this thread's pool; NULL detaches
+void rec_private_attach(round_rec_t *recs, uint32_t n)
+{
+    t_rec_private = recs;
+    t_rec_private_free = REC_NONE;
+    for (uint32_t i = recs ? n : 0; i > 0; --i)
+    {
+        recs[i - 1].next = t_rec_private_free;
+        t_rec_private_free = (rec_handle_t)(ROUND_REC_POOL_SIZE + i - 1);
+    }
+}
+
+// Returns a zeroed record with refcnt=1, or REC_NONE when the pool is exhausted
+rec_handle_t rec_alloc(void)
+{
+    rec_handle_t h;
+    if (t_rec_private)
+    {
+        h = t_rec_private_free;
+        if (h == REC_NONE)
+        {
+            atomic_fetch_add_explicit(&g_rec_exhausted, 1, memory_order_relaxed);
+            return REC_NONE;
+        }
+        t_rec_private_free = rec_get(h)->next;
+    }
+    else
+    {
+        rec_pool_init();
+        uint32_t old = atomic_load_explicit(&g_rec_free_head, memory_order_acquire);
+        uint32_t nxt;
+        do
+        {
+            h = (rec_handle_t)(old & 0xFFFFu);
+            if (h == REC_NONE)
+            {
+                atomic_fetch_add_explicit(&g_rec_exhausted, 1, memory_order_relaxed);
+                return REC_NONE;
+            }
+            nxt = ((old + 0x10000u) & 0xFFFF0000u) | g_rec_pool[h].next;
+        } while (!atomic_compare_exchange_weak_explicit(&g_rec_free_head, &old, nxt,
+                                                        memory_order_acquire, memory_order_acquire));
+    }
+
+    round_rec_t *r = rec_get(h);
+    memset(r, 0, offsetof(round_rec_t, refcnt));
+    atomic_store_explicit(&r->refcnt, 1, memory_order_relaxed);
+    return h;
+}
+
+// One extra reference per fan-out consumer
+void rec_retain(rec_handle_t h)
+{
+    atomic_fetch_add_explicit(&rec_get(h)->refcnt, 1, memory_order_relaxed);
+}
+
+// Last release returns the record to the pool it came from
+void rec_release(rec_handle_t h)
+{
+    round_rec_t *r = rec_get(h);
+    if (atomic_fetch_sub_explicit(&r->refcnt, 1, memory_order_acq_rel) != 1)
+        return;
+    if (h < ROUND_REC_POOL_SIZE)
+        rec_push_free(h);
+    else
+    {
+        r->next = t_rec_private_free;
+        t_rec_private_free = h;
+    }
+}
+
 /* =========================
    PI1 — GPIO / TIMERS / BASIC UI
    ========================= */
@@ -60,37 +634,127 @@ static uint32_t clamp(uint32_t v, uint32_t lo, uint32_t hi)
 int pi1_button_pressed(void)
 {
     // For demo: press on every iteration start
-    printf("[PI1] Start button pressed.\n");
+    LOG("[PI1] Start button pressed.\n");
     return 1;
 }
 
+static __thread uint32_t g_mock_wait_ms = 0; // nonzero: fixed foreperiod (C ABI inputs)
+
 // Mock: random wait 1–3 s
 uint32_t pi1_compute_random_wait_ms(void)
 {
     uint32_t span = RANDOM_WAIT_MAX_MS - RANDOM_WAIT_MIN_MS;
     // Generate a real random number within the span
-    uint32_t random_offset = rand() % (span + 1);
-    uint32_t res = RANDOM_WAIT_MIN_MS + random_offset;
-    printf("[PI1] Random wait chosen = %ums\n", res);
+    uint32_t random_offset = mock_rand() % (span + 1);
+    uint32_t res = g_mock_wait_ms ? g_mock_wait_ms : RANDOM_WAIT_MIN_MS + random_offset;
+    LOG("[PI1] Random wait chosen = %ums\n", res);
     return res;
 }
 
-// Mock: drive LED green + short vibration burst
+// Waveform engine (mock output-compare + DMA): each channel plays a precomputed segment table on its own.
+// Firing a pattern is one descriptor write per channel; onset is the timer value written, not when the CPU gets to it.
+typedef struct
+{
+    uint16_t dur_ms; // 0 = hold until the channel is re-fired
+    uint16_t value;  // LED / vibration: PWM duty 0..255; buzzer: tone Hz (0 = silent)
+} wave_seg_t;
+
+typedef enum
+{
+    WAVE_LED = 0,
+    WAVE_VIBE,
+    WAVE_BUZZER,
+    WAVE_CHANNELS
+} wave_chan_t;
+
+typedef enum
+{
+    WAVE_T_NONE = 0, // channel left as is
+    WAVE_T_LED_GREEN,
+    WAVE_T_VIBE_BUZZ,
+    WAVE_T_LED_BLINK,
+    WAVE_T_BUZZER_TUNE,
+    WAVE_TABLES
+} wave_table_t;
+
+static const wave_seg_t wave_led_green[] = {{VISUAL_WINDOW_MS + TACTILE_WINDOW_MS, 255}};
+static const wave_seg_t wave_vibe_buzz[] = {{10, 255}, {60, 160}, {10, 0}}; // kick, hold, brake
+static const wave_seg_t wave_led_blink[] = {{100, 255}, {100, 0}, {100, 255}, {100, 0}, {100, 255}, {100, 0}};
+static const wave_seg_t wave_buzzer_tune[] = {{120, 2000}, {40, 0}, {120, 2600}, {40, 0}, {200, 3200}};
+
+static const struct
+{
+    const wave_seg_t *seg;
+    uint16_t n;
+} wave_tables[WAVE_TABLES] = {
+    {NULL, 0},
+    {wave_led_green, sizeof(wave_led_green) / sizeof(wave_seg_t)},
+    {wave_vibe_buzz, sizeof(wave_vibe_buzz) / sizeof(wave_seg_t)},
+    {wave_led_blink, sizeof(wave_led_blink) / sizeof(wave_seg_t)},
+    {wave_buzzer_tune, sizeof(wave_buzzer_tune) / sizeof(wave_seg_t)},
+};
+
+// What each channel plays for a pattern (WAVE_T_NONE leaves it running)
+static const uint8_t wave_stim[WAVE_CHANNELS] = {WAVE_T_LED_GREEN, WAVE_T_VIBE_BUZZ, WAVE_T_NONE};
+static const uint8_t wave_feedback[WAVE_CHANNELS] = {WAVE_T_LED_BLINK, WAVE_T_NONE, WAVE_T_BUZZER_TUNE};
+
+static __thread uint64_t g_wave_reg[WAVE_CHANNELS]; // DMA descriptor: table << 32 | start (timer ms)
+static __thread uint32_t g_timer_base_ms;           // free-running timer = base + g_time (base moves per round)
+
+static inline uint32_t timer_now_ms(void)
+{
+    return g_timer_base_ms + g_time;
+}
+
+static inline void wave_fire(const uint8_t pattern[WAVE_CHANNELS], uint32_t start_ms)
+{
+    for (uint32_t c = 0; c < WAVE_CHANNELS; ++c)
+        if (pattern[c] != WAVE_T_NONE)
+            g_wave_reg[c] = (uint64_t)pattern[c] << 32 | start_ms;
+}
+
+// Channel output at timer ms t, as the peripheral would drive the pin (observers only; costs nothing while playing)
+uint16_t wave_level(wave_chan_t c, uint32_t t)
+{
+    uint64_t reg = g_wave_reg[c];
+    uint32_t table = (uint32_t)(reg >> 32), start = (uint32_t)reg;
+    uint32_t at = t - start; // modular: the 32-bit ms timer wraps every ~49.7 days
+    if (table == WAVE_T_NONE || table >= WAVE_TABLES || (int32_t)at < 0)
+        return 0;
+    for (uint16_t i = 0; i < wave_tables[table].n; ++i)
+    {
+        const wave_seg_t *sg = &wave_tables[table].seg[i];
+        if (sg->dur_ms == 0 || at < sg->dur_ms)
+            return sg->value;
+        at -= sg->dur_ms;
+    }
+    return 0;
+}
+
+// STIM_ON: LED green + short vibration burst, started by the timer at the current ms
 void pi1_stim_on_led_and_vibe(void)
 {
-    printf("[PI1] STIM_ON: LED=GREEN, vibration=short buzz\n");
+    wave_fire(wave_stim, timer_now_ms());
+    LOG("[PI1] STIM_ON: LED=GREEN, vibration=short buzz\n");
+}
+
+// FEEDBACK: LED blink + buzzer tune; plays on into the next round without CPU involvement
+void pi1_feedback_best(void)
+{
+    wave_fire(wave_feedback, timer_now_ms());
+    LOG("[PI1] BEST improved → LED blink + buzzer\n");
 }
 
 // Mock: 7-seg display show message (eg. "GO")
 void pi1_7seg_show_msg(const char *label)
 {
-    printf("[PI1] 7SEG: %s\n", label);
+    LOG("[PI1] 7SEG: %s\n", label);
 }
 
 // Mock: 7-seg display show number (ms)
 void pi1_7seg_show_ms(const char *label, uint32_t ms)
 {
-    printf("[PI1] 7SEG: %s = %u ms\n", label, ms);
+    LOG("[PI1] 7SEG: %s = %u ms\n", label, ms);
 }
 
 
@@ -113,14 +777,19 @@ static const uint32_t round_data[6][2] = {
     {2450, 2630}   // Round 6: Normal - visual at 450ms, tactile 180ms later
 };
 
+// Active mock table (WCET harness swaps in its own adversarial rows)
+static __thread const uint32_t (*g_mock_data)[2] = round_data;
+static __thread uint32_t g_mock_rounds = 6;
+static __thread uint16_t g_mock_pressure = 0;  // nonzero: ADC value while pressing (C ABI inputs)
+
 // Mock: visual sensor detection function
 int visual_sensor_output(uint32_t mock_time)
 {
-    if (g_round_ix < 1 || g_round_ix > 6)
+    if (g_round_ix < 1 || g_round_ix > g_mock_rounds)
         return 0;
     
     // Mock: Get visual detection time for current round
-    uint32_t visual_time = round_data[g_round_ix - 1][0];
+    uint32_t visual_time = g_mock_data[g_round_ix - 1][0];
     
     // Return 1 if we've reached visual detection time
     return (mock_time >= visual_time) ? 1 : 0;
@@ -128,11 +797,11 @@ int visual_sensor_output(uint32_t mock_time)
 
 int tactile_sensor_output(uint32_t mock_time)
 {
-    if (g_round_ix < 1 || g_round_ix > 6)
+    if (g_round_ix < 1 || g_round_ix > g_mock_rounds)
         return 0;
     
     // Mock: Get tactile detection time for current round
-    uint32_t tactile_time = round_data[g_round_ix - 1][1];
+    uint32_t tactile_time = g_mock_data[g_round_ix - 1][1];
     
     // Return 1 if we've reached tactile detection time
     return (mock_time >= tactile_time) ? 1 : 0;
@@ -145,13 +814,200 @@ uint32_t pi2_capture_visual_ms(uint32_t window_ms)
     uint32_t base = 180 + (37 * ((g_round_ix * 5) % 10)); // 180..550
     if (base > window_ms)
     {
-        printf("[PI2] Visual timeout (> %u ms)\n", window_ms);
+        LOG("[PI2] Visual timeout (> %u ms)\n", window_ms);
         return 0;
     }
-    printf("[PI2] Visual reaction captured = %u ms\n", base);
+    LOG("[PI2] Visual reaction captured = %u ms\n", base);
     return base;
 }
 
+// Matched-filter echo detection on the raw receiver waveform (upgraded PI2 sensor)
+#define ECHO_FS_HZ 400000u        // receiver ADC sample rate
+#define ECHO_BURST_HZ 40000u      // transducer frequency
+#define ECHO_MAX_TAPS 1024        // longest template
+#define ECHO_DIRECT_MAX_TAPS 192  // up to here: SIMD direct form; longer: FFT overlap-save
+#define ECHO_FFT_N 4096           // overlap-save block (power of 2, > 2 * ECHO_MAX_TAPS)
+#define ECHO_DETECT_K2 16.0f      // envelope² peak must exceed K2 × its mean (12 dB over the noise floor)
+
+typedef float v4f __attribute__((vector_size(16)));
+
+// I/Q templates: the envelope |x ⋆ (t_i + j·t_q)| peaks at arrival regardless of carrier phase
+typedef struct
+{
+    uint32_t ntaps;
+    bool use_fft;
+    float t_i[ECHO_MAX_TAPS], t_q[ECHO_MAX_TAPS];
+    float h_re[ECHO_FFT_N], h_im[ECHO_FFT_N]; // FFT of the zero-padded complex template
+    float tw_re[ECHO_FFT_N / 2], tw_im[ECHO_FFT_N / 2];
+    float b_re[ECHO_FFT_N], b_im[ECHO_FFT_N]; // block scratch
+} echo_detector_t;
+
+static inline v4f v4f_load(const float *p)
+{
+    v4f v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// y[i] = (Σ_k x[i+k]·ti[k])² + (Σ_k x[i+k]·tq[k])² for i < nout; 4 lags per pass, taps broadcast across lanes
+static void echo_direct(const float *x, uint32_t nout, const float *ti, const float *tq, uint32_t m, float *y)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= nout; i += 4)
+    {
+        v4f ai = {0, 0, 0, 0}, aq = {0, 0, 0, 0};
+        for (uint32_t k = 0; k < m; ++k)
+        {
+            v4f xv = v4f_load(x + i + k);
+            v4f vi = {ti[k], ti[k], ti[k], ti[k]}, vq = {tq[k], tq[k], tq[k], tq[k]};
+            ai += xv * vi;
+            aq += xv * vq;
+        }
+        v4f e = ai * ai + aq * aq;
+        memcpy(y + i, &e, sizeof(e));
+    }
+    for (; i < nout; ++i)
+    {
+        float ai = 0.0f, aq = 0.0f;
+        for (uint32_t k = 0; k < m; ++k)
+            ai += x[i + k] * ti[k], aq += x[i + k] * tq[k];
+        y[i] = ai * ai + aq * aq;
+    }
+}
+
+// In-place iterative radix-2 FFT of length ECHO_FFT_N (inverse: conjugate twiddles, unscaled)
+static void echo_fft(const echo_detector_t *d, float *re, float *im, bool inverse)
+{
+    for (uint32_t i = 1, j = 0; i < ECHO_FFT_N; ++i)
+    {
+        uint32_t bit = ECHO_FFT_N >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j |= bit;
+        if (i < j)
+        {
+            float tr = re[i], ti = im[i];
+            re[i] = re[j], im[i] = im[j];
+            re[j] = tr, im[j] = ti;
+        }
+    }
+    for (uint32_t len = 2; len <= ECHO_FFT_N; len <<= 1)
+    {
+        uint32_t step = ECHO_FFT_N / len;
+        for (uint32_t i = 0; i < ECHO_FFT_N; i += len)
+            for (uint32_t k = 0; k < len / 2; ++k)
+            {
+                float wr = d->tw_re[k * step], wi = inverse ? -d->tw_im[k * step] : d->tw_im[k * step];
+                uint32_t a = i + k, b = a + len / 2;
+                float xr = re[b] * wr - im[b] * wi, xi = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - xr, im[b] = im[a] - xi;
+                re[a] += xr, im[a] += xi;
+            }
+    }
+}
+
+void echo_init(echo_detector_t *d, const float *ti, const float *tq, uint32_t ntaps)
+{
+    d->ntaps = ntaps < ECHO_MAX_TAPS ? ntaps : ECHO_MAX_TAPS;
+    d->use_fft = d->ntaps > ECHO_DIRECT_MAX_TAPS;
+    memcpy(d->t_i, ti, d->ntaps * sizeof(float));
+    memcpy(d->t_q, tq, d->ntaps * sizeof(float));
+    for (uint32_t k = 0; k < ECHO_FFT_N / 2; ++k)
+    {
+        d->tw_re[k] = (float)cos(-2.0 * M_PI * k / ECHO_FFT_N);
+        d->tw_im[k] = (float)sin(-2.0 * M_PI * k / ECHO_FFT_N);
+    }
+    memset(d->h_re, 0, sizeof(d->h_re));
+    memset(d->h_im, 0, sizeof(d->h_im));
+    memcpy(d->h_re, ti, d->ntaps * sizeof(float));
+    memcpy(d->h_im, tq, d->ntaps * sizeof(float));
+    echo_fft(d, d->h_re, d->h_im, false);
+}
+
+// Hann-windowed burst at ECHO_BURST_HZ sampled at ECHO_FS_HZ (ti = transmitted, tq = 90° shifted); returns taps
+uint32_t echo_burst_template(float *ti, float *tq, uint32_t cycles)
+{
+    uint32_t m = cycles * ECHO_FS_HZ / ECHO_BURST_HZ;
+    m = m < ECHO_MAX_TAPS ? m : ECHO_MAX_TAPS;
+    for (uint32_t k = 0; k < m; ++k)
+    {
+        // a 1-tap "burst" is unwindowed (the Hann formula would divide by m - 1 = 0)
+        double w = m > 1 ? 0.5 - 0.5 * cos(2.0 * M_PI * k / (m - 1)) : 1.0;
+        double ph = 2.0 * M_PI * ECHO_BURST_HZ * k / ECHO_FS_HZ;
+        ti[k] = (float)(w * sin(ph));
+        tq[k] = (float)(w * cos(ph));
+    }
+    return m;
+}
+
+// Envelope² of x[0..n) against the template into y[0..n - ntaps]; returns outputs written
+uint32_t echo_correlate(echo_detector_t *d, const float *x, uint32_t n, float *y)
+{
+    uint32_t m = d->ntaps;
+    if (n < m)
+        return 0;
+    uint32_t nout = n - m + 1;
+    if (!d->use_fft)
+    {
+        echo_direct(x, nout, d->t_i, d->t_q, m, y);
+        return nout;
+    }
+    // overlap-save: each block yields ECHO_FFT_N - m + 1 non-wrapped lags of X·conj(H)
+    uint32_t valid = ECHO_FFT_N - m + 1;
+    const float scale = 1.0f / ((float)ECHO_FFT_N * (float)ECHO_FFT_N);
+    for (uint32_t pos = 0; pos < nout; pos += valid)
+    {
+        uint32_t take = n - pos < ECHO_FFT_N ? n - pos : ECHO_FFT_N;
+        memcpy(d->b_re, x + pos, take * sizeof(float));
+        memset(d->b_re + take, 0, (ECHO_FFT_N - take) * sizeof(float));
+        memset(d->b_im, 0, sizeof(d->b_im));
+        echo_fft(d, d->b_re, d->b_im, false);
+        for (uint32_t k = 0; k < ECHO_FFT_N; ++k)
+        {
+            float r = d->b_re[k] * d->h_re[k] + d->b_im[k] * d->h_im[k];
+            float i = d->b_im[k] * d->h_re[k] - d->b_re[k] * d->h_im[k];
+            d->b_re[k] = r, d->b_im[k] = i;
+        }
+        echo_fft(d, d->b_re, d->b_im, true);
+        uint32_t cnt = nout - pos < valid ? nout - pos : valid;
+        for (uint32_t k = 0; k < cnt; ++k)
+            y[pos + k] = (d->b_re[k] * d->b_re[k] + d->b_im[k] * d->b_im[k]) * scale;
+    }
+    return nout;
+}
+
+// Echo arrival in µs from the start of x; 0 if nothing clears the noise floor.
+// The envelope peak is about ntaps wide, so noise moves it by ~sqrt(ntaps) samples whatever the interpolation:
+// the 3-point parabola only removes the 2.5 µs sample grid (see 'bench echo' for the RMS error per burst length)
+uint32_t pi2_echo_arrival_us(echo_detector_t *d, const float *x, uint32_t n, float *env)
+{
+    uint32_t nout = echo_correlate(d, x, n, env);
+    if (nout < 3)
+        return 0;
+    uint32_t best = 0;
+    double sum = 0.0;
+    for (uint32_t i = 0; i < nout; ++i)
+    {
+        sum += env[i];
+        if (env[i] > env[best])
+            best = i;
+    }
+    if (env[best] < ECHO_DETECT_K2 * (float)(sum / nout))
+    {
+        LOG("[PI2] Echo: no peak above noise\n");
+        return 0;
+    }
+    float frac = 0.0f;
+    if (best > 0 && best + 1 < nout)
+    {
+        float a = env[best - 1], b = env[best], c = env[best + 1], den = a - 2.0f * b + c;
+        frac = den != 0.0f ? 0.5f * (a - c) / den : 0.0f;
+    }
+    uint32_t us = (uint32_t)(((float)best + frac) * 1e6f / ECHO_FS_HZ + 0.5f);
+    LOG("[PI2] Echo arrival = %u us\n", us);
+    return us ? us : 1;
+}
+
 /* =========================
    PI3 — ADC + UART: PRESSURE / POT / REPORT
    ========================= */
@@ -160,8 +1016,8 @@ uint32_t pi2_capture_visual_ms(uint32_t window_ms)
 uint16_t pi3_read_pressure_adc(void)
 {
     // Generate values that cross threshold after some delay; if round %5==2, timeout
-    uint16_t val = (g_round_ix % 5 == 2) ? 200 : (300 + (g_round_ix * 150) % 600);
-    printf("[PI3] Pressure ADC = %u\n", val);
+    uint16_t val = g_mock_pressure ? g_mock_pressure : (g_round_ix % 5 == 2) ? 200 : (300 + (g_round_ix * 150) % 600);
+    LOG("[PI3] Pressure ADC = %u\n", val);
     return val;
 }
 
@@ -171,7 +1027,7 @@ uint32_t pi3_capture_tactile_ms(uint32_t window_ms, uint16_t threshold)
     // Synthesize a tactile time derived from round index
     if (g_round_ix % 5 == 2)
     {
-        printf("[PI3] Tactile timeout (no press within %u ms)\n", window_ms);
+        LOG("[PI3] Tactile timeout (no press within %u ms)\n", window_ms);
         return 0;
     }
     uint32_t t = 140 + (23 * ((g_round_ix * 3) % 12)); // 140..~400
@@ -184,147 +1040,5007 @@ uint32_t pi3_capture_tactile_ms(uint32_t window_ms, uint16_t threshold)
     }
     if (t > window_ms)
     {
-        printf("[PI3] Tactile timeout (computed %u > %u)\n", t, window_ms);
+        LOG("[PI3] Tactile timeout (computed %u > %u)\n", t, window_ms);
         return 0;
     }
-    printf("[PI3] Tactile reaction captured = %u ms\n", t);
+    LOG("[PI3] Tactile reaction captured = %u ms\n", t);
     return t;
 }
 
-// Mock: UART TX of the round result
-void pi3_uart_send_result(uint32_t rnd,
-                          uint32_t wait_ms,
-                          uint32_t vis_ms,
-                          uint32_t tact_ms,
-                          uint32_t total_ms,
-                          uint32_t best_ms)
+// Mock: UART TX of the round result (pipeline stage; consumes one reference).
+// Every round goes out with the station's sequence number so the hub can dedupe and detect gaps.
+void pi3_uart_send_result(rec_handle_t h)
 {
-    printf("[PI3][UART %d bps] Rnd=%u, Wait=%u, Vis=%u, Tact=%u, Total=%u, Best=%u\n",
-           UART_BAUD, rnd, wait_ms, vis_ms, tact_ms, total_ms, best_ms);
+    const round_rec_t *r = rec_get(h);
+    char frame[128];
+    PROF_BEGIN(PROF_FORMAT);
+    int n = snprintf(frame, sizeof(frame), "Stn=%u, Seq=%u, ", STATION_ID, r->seq);
+    if (r->player)
+        n += snprintf(frame + n, sizeof(frame) - (size_t)n, "Ply=%u, ", r->player);
+    if (r->cause != ABORT_NONE)
+        snprintf(frame + n, sizeof(frame) - (size_t)n, "Rnd=%u, Abort=%s", r->round_ix,
+                 abort_cause_names[r->cause]);
+    else
+        snprintf(frame + n, sizeof(frame) - (size_t)n, "Rnd=%u, Wait=%u, Vis=%u, Tact=%u, Total=%u, Best=%u",
+                 r->round_ix, r->wait_ms, r->vis_ms, r->tact_ms, r->total_ms, r->best_ms);
+    PROF_END(PROF_FORMAT);
+    LOG("[PI3][UART %d bps] %s\n", UART_BAUD, frame);
+    rec_release(h);
 }
 
 /* =========================
-   State-machine helpers (composition)
+   PI3 ADC model + scan scheduler (./reflex adc [resolution_us])
    ========================= */
+#define ADC_CLOCK_HZ 14000000u   // converter clock
+#define ADC_SAMPLE_CLKS 15u      // sample-and-hold acquisition
+#define ADC_CONV_CLKS 13u        // 12-bit SAR conversion
+#define ADC_MAX_SPS 1000000u     // datasheet limit on conversions/s
+#define ADC_MUX_SETTLE_NS 2000u  // extra acquisition after the mux switches channel
+#define ADC_CPU_PER_CONV_NS 400u // end-of-conversion ISR: read, store, re-arm
+#define ADC_CPU_BUDGET_PCT 10u   // share of one core the ADC path may use
+#define ADC_UTIL_MAX_PCT 80u     // converter busy limit in any frame (headroom for jitter)
+#define ADC_MAX_FRAMES 1024u     // plan length cap (hyperperiod in frames)
+#define ADC_MAX_SLOTS 8u         // conversions per frame
 
-void state_to_idle(void)
+typedef struct
 {
-    g_state = ST_IDLE;
-    printf("[SYS] → IDLE\n");
-}
-void state_to_abort(void)
-{
-    g_state = ST_ABORT_RETRY;
-    g_time = 0; // reset mock time
-    printf("[SYS] → ABORT/RETRY\n");
+    const char *name;
+    uint32_t period_us; // required sample period (0 = the tactile resolution)
+} adc_chan_t;
+
+static const adc_chan_t adc_chans[] = {
+    {"pressure", 0},           // tactile press detection
+    {"pressure2", 0},          // second player's pad (duel mode)
+    {"pot", 20000},            // threshold potentiometer
+    {"vref", 500000},          // supply / reference check
+};
+#define ADC_CHANNELS (sizeof(adc_chans) / sizeof(adc_chans[0]))
+
+typedef struct
+{
+    uint32_t frame_us;                // one frame per tactile resolution step
+    uint32_t nframes;                 // plan repeats after this many frames
+    uint32_t every[ADC_CHANNELS];     // channel sampled every N frames (power of two)
+    uint32_t phase[ADC_CHANNELS];     // ... starting at this frame
+    uint32_t worst_busy_ns;           // longest frame (settling + conversions)
+    double adc_util, cpu_load;        // converter busy share (average), CPU share of one core
+    bool fits;
+} adc_plan_t;
+
+static inline uint32_t adc_conv_ns(void)
+{
+    uint32_t conv = (uint32_t)((uint64_t)(ADC_SAMPLE_CLKS + ADC_CONV_CLKS) * 1000000000u / ADC_CLOCK_HZ);
+    uint32_t floor_ns = 1000000000u / ADC_MAX_SPS;
+    return conv > floor_ns ? conv : floor_ns;
 }
-void state_to_feedback(void)
+
+// Fast channels every frame; slow ones every 2^k frames at the phase that keeps the busiest frame smallest
+void adc_plan(adc_plan_t *p, uint32_t resolution_us)
 {
-    g_state = ST_FEEDBACK;
-    printf("[SYS] → FEEDBACK\n");
+    uint32_t load[ADC_MAX_FRAMES] = {0};
+    memset(p, 0, sizeof(*p));
+    p->frame_us = resolution_us ? resolution_us : 1;
+    p->nframes = 1;
+    for (uint32_t c = 0; c < ADC_CHANNELS; ++c)
+    {
+        uint32_t want = adc_chans[c].period_us ? adc_chans[c].period_us / p->frame_us : 1, n = 1;
+        while (n * 2 <= want && n * 2 <= ADC_MAX_FRAMES)
+            n *= 2;
+        p->every[c] = n;
+        if (n > p->nframes)
+            p->nframes = n;
+    }
+    for (uint32_t c = 0; c < ADC_CHANNELS; ++c)
+    {
+        uint32_t n = p->every[c], best_ph = 0, best_max = UINT32_MAX;
+        for (uint32_t ph = 0; ph < n; ++ph)
+        {
+            uint32_t mx = 0;
+            for (uint32_t f = ph; f < p->nframes; f += n)
+                mx = load[f] > mx ? load[f] : mx;
+            if (mx < best_max)
+                best_max = mx, best_ph = ph;
+        }
+        p->phase[c] = best_ph;
+        for (uint32_t f = best_ph; f < p->nframes; f += n)
+            load[f]++;
+    }
+
+    // Walk the plan in conversion order; a mux switch (including across frames) adds settling
+    uint64_t convs = 0, busy_total = 0;
+    uint32_t prev = UINT32_MAX, conv = adc_conv_ns();
+    for (uint32_t f = 0; f < p->nframes; ++f)
+    {
+        uint32_t busy = 0;
+        for (uint32_t c = 0; c < ADC_CHANNELS; ++c)
+        {
+            if (f % p->every[c] != p->phase[c])
+                continue;
+            busy += conv + (c != prev ? ADC_MUX_SETTLE_NS : 0);
+            prev = c;
+            convs++;
+        }
+        busy_total += busy;
+        if (busy > p->worst_busy_ns)
+            p->worst_busy_ns = busy;
+    }
+    double plan_ns = (double)p->nframes * p->frame_us * 1000.0;
+    p->adc_util = busy_total / plan_ns;
+    p->cpu_load = (double)convs * ADC_CPU_PER_CONV_NS / plan_ns;
+    p->fits = p->worst_busy_ns * 100.0 <= ADC_UTIL_MAX_PCT * p->frame_us * 1000.0 &&
+              p->cpu_load * 100.0 <= ADC_CPU_BUDGET_PCT;
+}
+
+int adc_run(uint32_t resolution_us)
+{
+    adc_plan_t p;
+    adc_plan(&p, resolution_us);
+    printf("=== ADC scan plan (tactile resolution %u us) ===\n", p.frame_us);
+    printf("converter: %u ns/conversion (%u+%u clks @ %.1f MHz, max %u kS/s), mux settle %u ns\n", adc_conv_ns(),
+           ADC_SAMPLE_CLKS, ADC_CONV_CLKS, ADC_CLOCK_HZ / 1e6, ADC_MAX_SPS / 1000, ADC_MUX_SETTLE_NS);
+    for (uint32_t c = 0; c < ADC_CHANNELS; ++c)
+        printf("  %-10s every %4u frame(s) from frame %3u  -> %8.1f S/s\n", adc_chans[c].name, p.every[c],
+               p.phase[c], 1e6 / ((double)p.every[c] * p.frame_us));
+    printf("plan: %u frames x %u us; worst frame busy %.2f us (%.0f%%, limit %u%%)\n", p.nframes, p.frame_us,
+           p.worst_busy_ns / 1000.0, p.worst_busy_ns / (10.0 * p.frame_us), ADC_UTIL_MAX_PCT);
+    printf("ADC busy %.1f%% average; CPU %.2f%% of one core (budget %u%%)\n", 100.0 * p.adc_util, 100.0 * p.cpu_load,
+           ADC_CPU_BUDGET_PCT);
+    uint32_t lo = 1, hi = 1000000;
+    while (lo < hi) // finest resolution that still fits (feasibility is monotone in the frame length)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        adc_plan_t q;
+        adc_plan(&q, mid);
+        if (q.fits)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    printf("verdict: %s; finest feasible resolution %u us (round engine polls every 1000 us)\n",
+           p.fits ? "fits" : "DOES NOT FIT", lo);
+    return p.fits ? 0 : 1;
 }
 
 /* =========================
-   One game round (blocking mock)
+   Player store (mock persistent profiles)
    ========================= */
-void run_one_round(void)
+typedef struct
 {
-    // Reset score improvement flag at start of each round
-    g_score_improved = false;
-    g_time = 0;
+    uint32_t id;
+    uint32_t best_ms; // 0xFFFFFFFF = no completed round yet
+    uint32_t rounds;  // completed rounds
+    uint32_t reserved;
+} player_profile_t;
 
-    // IDLE
-    state_to_idle();
-    if (!pi1_button_pressed())
+static player_profile_t g_profiles[PLAYER_STORE_CAPACITY];
+static __thread player_profile_t *g_active_profile = NULL; // REPORT updates this record in place
+
+static inline player_profile_t *player_store_slot(uint32_t id)
+{
+    return &g_profiles[id % PLAYER_STORE_CAPACITY];
+}
+
+// Read-only copy of a player's record; a slot holding another id reads as a new player
+player_profile_t player_store_read(uint32_t id)
+{
+    const player_profile_t *p = player_store_slot(id);
+    player_profile_t out = {id, 0xFFFFFFFF, 0, 0};
+    if (p->id == id)
+        out = *p;
+    return out;
+}
+
+// Fetch (or create) a player's record
+player_profile_t *player_store_get(uint32_t id)
+{
+    player_profile_t *p = player_store_slot(id);
+    if (p->id != id)
+    {
+        p->id = id;
+        p->best_ms = 0xFFFFFFFF;
+        p->rounds = 0;
+    }
+    return p;
+}
+
+// IDLE: start fetching the line REPORT will write; the miss overlaps the foreperiod scan instead of
+// stalling REPORT (saves one memory miss per round, nothing more). No-op for anonymous play
+static bool g_profile_prefetch = true;
+
+void player_store_prefetch(uint32_t id)
+{
+    if (id == 0 || !g_profile_prefetch)
         return;
+    __builtin_prefetch(player_store_slot(id), 1, 3);
+}
 
-    // ARMED
-    g_state = ST_ARMED;
-    g_random_wait_ms = pi1_compute_random_wait_ms();
+/* =========================
+   Player cache (sharded CLOCK, read-through; hub lookups)
+   ========================= */
+#define PCACHE_SHARD_BITS 6
+#define PCACHE_SHARDS (1 << PCACHE_SHARD_BITS)
+#define PCACHE_SHARD_ENTRIES 1024 // 64 K cached profiles in total
+#define PCACHE_WAYS 8           // set-associative within a shard; CLOCK per set
+#define STORE_READ_SPIN 2000    // mock: cycles burned by a persistent-store read
 
-    // Early hand? (false trigger) — PI2
-    for (int t = g_time; t < g_random_wait_ms; t += 1)
+typedef struct
+{
+    uint32_t key; // player id (0 = empty)
+    uint32_t best_ms;
+    uint32_t rounds;
+    uint8_t ref; // CLOCK reference bit
+} pcache_entry_t;
+
+typedef struct
+{
+    _Alignas(64) pthread_mutex_t lock;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint8_t hand[PCACHE_SHARD_ENTRIES / PCACHE_WAYS];
+    uint32_t ver[PCACHE_SHARD_ENTRIES / PCACHE_WAYS]; // bumped by every pcache_update() into the set
+    pcache_entry_t e[PCACHE_SHARD_ENTRIES];
+} pcache_shard_t;
+
+static pcache_shard_t g_pcache[PCACHE_SHARDS];
+static pthread_once_t g_pcache_once = PTHREAD_ONCE_INIT;
+
+static void pcache_init(void)
+{
+    for (int i = 0; i < PCACHE_SHARDS; ++i)
+        pthread_mutex_init(&g_pcache[i].lock, NULL);
+}
+
+static inline uint32_t pcache_hash(uint32_t id)
+{
+    return id * 2654435761u; // Fibonacci hashing
+}
+
+// Mock: slow read from the persistent store
+static player_profile_t store_read_profile(uint32_t id)
+{
+    uint64_t c0 = cycles_now();
+    while (cycles_now() - c0 < STORE_READ_SPIN)
+        ;
+    return player_store_read(id);
+}
+
+// Read-through lookup of a player's best/rounds; returns false for unknown players
+bool pcache_lookup(uint32_t id, uint32_t *best_ms, uint32_t *rounds)
+{
+    pthread_once(&g_pcache_once, pcache_init);
+    uint32_t hsh = pcache_hash(id);
+    pcache_shard_t *sh = &g_pcache[hsh >> (32 - PCACHE_SHARD_BITS)];
+    uint32_t set = (hsh & (PCACHE_SHARD_ENTRIES / PCACHE_WAYS - 1));
+    pcache_entry_t *ways = &sh->e[set * PCACHE_WAYS];
+
+    pthread_mutex_lock(&sh->lock);
+    for (int w = 0; w < PCACHE_WAYS; ++w)
     {
-        if (visual_sensor_output(t))
+        if (ways[w].key == id)
         {
-            state_to_abort();
-            return;
+            ways[w].ref = 1;
+            sh->hits++;
+            *best_ms = ways[w].best_ms;
+            *rounds = ways[w].rounds;
+            pthread_mutex_unlock(&sh->lock);
+            return true;
         }
-        g_time = t;
     }
+    sh->misses++;
 
-    // STIM_ON
-    g_state = ST_STIM_ON;
-    pi1_stim_on_led_and_vibe();
+    // miss: fetch outside the shard lock; re-read if an update hit the set meanwhile, so a stale
+    // profile is never installed (pcache_update cannot fix entries that are not cached yet)
+    player_profile_t p;
+    uint32_t ver;
+    do
+    {
+        ver = sh->ver[set];
+        pthread_mutex_unlock(&sh->lock);
+        p = store_read_profile(id);
+        pthread_mutex_lock(&sh->lock);
+    } while (sh->ver[set] != ver);
 
-    // VISUAL measure — PI2
-    uint32_t visual_start_time = g_time; // Capture start time to avoid issues if g_time changes
-    for (int t = visual_start_time; t < visual_start_time + VISUAL_WINDOW_MS; t += 1)
+    // install with CLOCK replacement
+    int victim = -1;
+    for (int w = 0; w < PCACHE_WAYS && victim < 0; ++w)
+        if (ways[w].key == id || ways[w].key == 0)
+            victim = w;
+    while (victim < 0)
     {
-        if (visual_sensor_output(t))
+        uint8_t hnd = sh->hand[set];
+        sh->hand[set] = (uint8_t)((hnd + 1) % PCACHE_WAYS);
+        if (ways[hnd].ref)
+            ways[hnd].ref = 0;
+        else
         {
-            g_visual_ms = t - visual_start_time;
-            g_state = ST_VIS_DONE;
-            g_time = t; // Update g_time to current position
+            victim = hnd;
+            sh->evictions++;
+        }
+    }
+    ways[victim].key = id;
+    ways[victim].best_ms = p.best_ms;
+    ways[victim].rounds = p.rounds;
+    ways[victim].ref = 1;
+    pthread_mutex_unlock(&sh->lock);
+
+    *best_ms = p.best_ms;
+    *rounds = p.rounds;
+    return p.rounds > 0;
+}
+
+// Write-through: refresh a cached entry after the store changed (no insert)
+void pcache_update(uint32_t id, uint32_t best_ms, uint32_t rounds)
+{
+    pthread_once(&g_pcache_once, pcache_init);
+    uint32_t hsh = pcache_hash(id);
+    pcache_shard_t *sh = &g_pcache[hsh >> (32 - PCACHE_SHARD_BITS)];
+    uint32_t set = (hsh & (PCACHE_SHARD_ENTRIES / PCACHE_WAYS - 1));
+    pcache_entry_t *ways = &sh->e[set * PCACHE_WAYS];
+
+    pthread_mutex_lock(&sh->lock);
+    sh->ver[set]++; // in-flight misses in this set re-read the store
+    for (int w = 0; w < PCACHE_WAYS; ++w)
+    {
+        if (ways[w].key == id)
+        {
+            ways[w].best_ms = best_ms;
+            ways[w].rounds = rounds;
             break;
         }
-        g_time = t; // Update g_time as we progress through the loop
     }
-    if (g_state != ST_VIS_DONE)
+    pthread_mutex_unlock(&sh->lock);
+}
+
+typedef struct
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} pcache_stats_t;
+
+pcache_stats_t pcache_stats(void)
+{
+    pcache_stats_t st = {0, 0, 0};
+    for (int i = 0; i < PCACHE_SHARDS; ++i)
     {
-        state_to_abort(); // treat visual timeout as abort/retry
-        return;
+        pthread_mutex_lock(&g_pcache[i].lock);
+        st.hits += g_pcache[i].hits;
+        st.misses += g_pcache[i].misses;
+        st.evictions += g_pcache[i].evictions;
+        pthread_mutex_unlock(&g_pcache[i].lock);
     }
-    pi1_7seg_show_ms("VIS", g_visual_ms);
+    return st;
+}
 
-    // TACTILE measure — PI3
-    uint32_t tactile_start_time = g_time; // Capture start time
-    for (int t = tactile_start_time; t < tactile_start_time + TACTILE_WINDOW_MS; t += 1)
+void pcache_reset(void)
+{
+    pthread_once(&g_pcache_once, pcache_init);
+    for (int i = 0; i < PCACHE_SHARDS; ++i)
     {
-        uint16_t adc = pi3_read_pressure_adc();
-        // if pressure threshold crossed and within window
-        if (adc >= PRESSURE_THRESHOLD && tactile_sensor_output(t))
+        pthread_mutex_lock(&g_pcache[i].lock);
+        g_pcache[i].hits = g_pcache[i].misses = g_pcache[i].evictions = 0;
+        memset(g_pcache[i].hand, 0, sizeof(g_pcache[i].hand));
+        memset(g_pcache[i].e, 0, sizeof(g_pcache[i].e));
+        pthread_mutex_unlock(&g_pcache[i].lock);
+    }
+}
+
+// Pipeline stage: keep cached hub answers in step with REPORT updates
+void pcache_stage(rec_handle_t h)
+{
+    const round_rec_t *r = rec_get(h);
+    if (r->player && g_active_profile && g_active_profile->id == r->player)
+        pcache_update(r->player, g_active_profile->best_ms, g_active_profile->rounds);
+    rec_release(h);
+}
+
+/* =========================
+   Percentile rank (population histogram of player bests; single writer)
+   ========================= */
+#define PCT_BUCKETS (VISUAL_WINDOW_MS + TACTILE_WINDOW_MS + 1) // 1 ms buckets
+#define PCT_BLOCK 64                                           // buckets per CDF block
+#define PCT_BLOCKS ((PCT_BUCKETS + PCT_BLOCK - 1) / PCT_BLOCK)
+#define PCT_BATCH 256    // updates folded into the CDF at once (lookups lag by < PCT_BATCH)
+#define PCT_STALE_PCT 1  // ...or sooner, once pending updates reach this % of the population
+
+typedef struct
+{
+    uint32_t count[PCT_BUCKETS];  // players whose best is in this bucket
+    uint32_t le[PCT_BUCKETS];     // published CDF: players with best ≤ bucket
+    uint32_t block_le[PCT_BLOCKS]; // published CDF at the end of each block
+    uint32_t players;             // population behind the published CDF
+    uint32_t live_players;
+    uint32_t pending;
+    uint32_t dirty_block; // lowest block touched since the last fold (PCT_BLOCKS = clean)
+} pct_hist_t;
+
+static pct_hist_t g_pct = {.dirty_block = PCT_BLOCKS};
+
+// Re-derive the CDF from the lowest dirty block onwards
+void pct_fold(pct_hist_t *ph)
+{
+    uint32_t blk = ph->dirty_block;
+    if (blk < PCT_BLOCKS)
+    {
+        uint32_t cum = blk ? ph->block_le[blk - 1] : 0;
+        for (; blk < PCT_BLOCKS; ++blk)
         {
-            g_tactile_ms = t - tactile_start_time;
-            g_state = ST_TACT_DONE;
-            g_time = t; // Update g_time
-            pi1_7seg_show_ms("TAC", g_tactile_ms);
-            break;
+            uint32_t end = (blk + 1) * PCT_BLOCK < PCT_BUCKETS ? (blk + 1) * PCT_BLOCK : PCT_BUCKETS;
+            for (uint32_t b = blk * PCT_BLOCK; b < end; ++b)
+                ph->le[b] = (cum += ph->count[b]);
+            ph->block_le[blk] = cum;
         }
-        g_time = t; // Update g_time
     }
-    if (g_state != ST_TACT_DONE)
+    ph->players = ph->live_players;
+    ph->pending = 0;
+    ph->dirty_block = PCT_BLOCKS;
+}
+
+// A player's best moved from prev_ms (0xFFFFFFFF = new player) to best_ms
+void pct_move(pct_hist_t *ph, uint32_t prev_ms, uint32_t best_ms)
+{
+    uint32_t b = clamp(best_ms, 0, PCT_BUCKETS - 1);
+    ph->count[b]++;
+    if (prev_ms == 0xFFFFFFFF)
+        ph->live_players++;
+    else
+        ph->count[clamp(prev_ms, 0, PCT_BUCKETS - 1)]--; // prev > best: its block is ≥ b's
+    if (b / PCT_BLOCK < ph->dirty_block)
+        ph->dirty_block = b / PCT_BLOCK;
+    // small populations fold (almost) every update, so the 7-seg percentile is never from an empty CDF
+    if (++ph->pending >= PCT_BATCH || (uint64_t)ph->pending * 100u >= (uint64_t)ph->live_players * PCT_STALE_PCT)
+        pct_fold(ph);
+}
+
+// Percent of ranked players whose best is slower than total_ms (one table index)
+static inline uint32_t pct_faster_than(const pct_hist_t *ph, uint32_t total_ms)
+{
+    if (ph->players == 0)
+        return 0;
+    uint32_t le = ph->le[clamp(total_ms, 0, PCT_BUCKETS - 1)];
+    return (uint32_t)((uint64_t)(ph->players - le) * 100u / ph->players);
+}
+
+/* =========================
+   Leaderboard (sharded; lock-free best/rank, per-shard top-K)
+   ========================= */
+#define LB_SHARD_BITS 4
+#define LB_SHARDS (1 << LB_SHARD_BITS)
+#define LB_MAX_TOTAL_MS (VISUAL_WINDOW_MS + TACTILE_WINDOW_MS)
+#define LB_TOPK 32 // entries kept per shard (max K for lb_top_k)
+
+typedef struct
+{
+    uint32_t total_ms;
+    uint32_t player;
+} lb_entry_t;
+
+typedef struct
+{
+    _Alignas(64) _Atomic uint32_t fen[LB_MAX_TOTAL_MS + 2]; // Fenwick tree: players by best total
+    _Alignas(64) pthread_mutex_t topk_lock;
+    uint32_t topk_n;
+    lb_entry_t topk[LB_TOPK]; // sorted by (total, player)
+} lb_shard_t;
+
+#define LB_PROBE_MAX 64 // linear probes before a player is left unranked (table full around its slot)
+
+// Open-addressed, insert-only: player id << 32 | (best + 1); low half 0 = not ranked yet
+static _Atomic uint64_t g_lb_best[PLAYER_STORE_CAPACITY];
+static lb_shard_t g_lb[LB_SHARDS];
+static pthread_once_t g_lb_once = PTHREAD_ONCE_INIT;
+
+static void lb_init(void)
+{
+    for (int i = 0; i < LB_SHARDS; ++i)
+        pthread_mutex_init(&g_lb[i].topk_lock, NULL);
+}
+
+static inline lb_shard_t *lb_shard(uint32_t player)
+{
+    return &g_lb[(player * 2654435761u) >> (32 - LB_SHARD_BITS)];
+}
+
+static inline void lb_fen_add(lb_shard_t *sh, uint32_t total_ms, int32_t delta)
+{
+    for (uint32_t i = total_ms + 1; i <= LB_MAX_TOTAL_MS + 1; i += i & (0u - i))
+        atomic_fetch_add_explicit(&sh->fen[i], (uint32_t)delta, memory_order_relaxed);
+}
+
+// Players in this shard whose best is < total_ms
+static inline uint32_t lb_fen_below(const lb_shard_t *sh, uint32_t total_ms)
+{
+    uint32_t n = 0;
+    for (uint32_t i = total_ms; i > 0; i -= i & (0u - i))
+        n += atomic_load_explicit(&sh->fen[i], memory_order_relaxed);
+    return n;
+}
+
+// Player's best slot; claim = take the first empty slot if the player has none. NULL if absent/full
+static _Atomic uint64_t *lb_best_slot(uint32_t player, bool claim)
+{
+    uint32_t home = player % PLAYER_STORE_CAPACITY;
+    for (uint32_t i = 0; i < LB_PROBE_MAX; ++i)
+    {
+        _Atomic uint64_t *slot = &g_lb_best[(home + i) % PLAYER_STORE_CAPACITY];
+        uint64_t v = atomic_load_explicit(slot, memory_order_acquire);
+        if (v == 0)
+        {
+            if (!claim)
+                return NULL; // slots are never freed, so the player would have been found by now
+            if (atomic_compare_exchange_strong_explicit(slot, &v, (uint64_t)player << 32, memory_order_acq_rel,
+                                                        memory_order_acquire))
+                return slot;
+            // lost the race: v is the winner's key, which may be this player too
+        }
+        if ((uint32_t)(v >> 32) == player)
+            return slot;
+    }
+    return NULL;
+}
+
+static void lb_topk_offer(lb_shard_t *sh, uint32_t player, uint32_t total_ms)
+{
+    lb_entry_t e = {total_ms, player};
+    pthread_mutex_lock(&sh->topk_lock);
+    uint32_t i = 0;
+    while (i < sh->topk_n && sh->topk[i].player != player)
+        ++i;
+    if (i < sh->topk_n && total_ms >= sh->topk[i].total_ms)
     {
-        printf("[SYS] No tactile within window → N/A\n");
-        state_to_abort(); // treat tactile timeout as abort/retry
+        // concurrent submits for one player can arrive out of order: keep the better listing
+        pthread_mutex_unlock(&sh->topk_lock);
         return;
     }
+    if (i == sh->topk_n) // not listed: take the tail slot if better than the worst
+    {
+        if (sh->topk_n < LB_TOPK)
+            sh->topk_n++;
+        else if (total_ms >= sh->topk[LB_TOPK - 1].total_ms)
+        {
+            pthread_mutex_unlock(&sh->topk_lock);
+            return;
+        }
+        i = sh->topk_n - 1;
+    }
+    // the listing only improves, so the entry only moves towards the head
+    while (i > 0 && (sh->topk[i - 1].total_ms > total_ms ||
+                     (sh->topk[i - 1].total_ms == total_ms && sh->topk[i - 1].player > player)))
+    {
+        sh->topk[i] = sh->topk[i - 1];
+        --i;
+    }
+    sh->topk[i] = e;
+    pthread_mutex_unlock(&sh->topk_lock);
+}
 
-    // REPORT
-    g_state = ST_REPORT;
-    uint32_t total = g_visual_ms + (g_tactile_ms);
-    if (total < g_best_total_ms){
-        g_best_total_ms = total;
-        g_score_improved = true;
+// Record a completed round; returns true when it improved the player's best
+// (prev_ms, if given, receives the replaced best or 0xFFFFFFFF for a new player)
+bool lb_submit(uint32_t player, uint32_t total_ms, uint32_t *prev_ms)
+{
+    if (player == 0 || total_ms > LB_MAX_TOTAL_MS)
+        return false;
+    pthread_once(&g_lb_once, lb_init);
+    _Atomic uint64_t *slot = lb_best_slot(player, true);
+    if (!slot)
+        return false;
+    uint64_t key = (uint64_t)player << 32;
+    uint32_t stored = total_ms + 1; // keep 0 as "not ranked"
+    uint64_t cur = atomic_load_explicit(slot, memory_order_relaxed);
+    uint32_t old;
+    do
+    {
+        old = (uint32_t)cur;
+        if (old != 0 && old <= stored)
+            return false;
+    } while (!atomic_compare_exchange_weak_explicit(slot, &cur, key | stored, memory_order_acq_rel,
+                                                    memory_order_relaxed));
+
+    if (prev_ms)
+        *prev_ms = old ? old - 1 : 0xFFFFFFFF;
+    lb_shard_t *sh = lb_shard(player);
+    lb_fen_add(sh, total_ms, +1);
+    if (old != 0)
+        lb_fen_add(sh, old - 1, -1);
+    lb_topk_offer(sh, player, total_ms);
+    return true;
+}
+
+// Competition rank (1 = best; ties share a rank), 0 if the player has no completed round
+uint32_t lb_rank(uint32_t player)
+{
+    _Atomic uint64_t *slot = lb_best_slot(player, false);
+    uint32_t stored = slot ? (uint32_t)atomic_load_explicit(slot, memory_order_acquire) : 0;
+    if (stored == 0)
+        return 0;
+    uint32_t better = 0;
+    for (int i = 0; i < LB_SHARDS; ++i)
+        better += lb_fen_below(&g_lb[i], stored - 1);
+    return better + 1;
+}
+
+// Merge the per-shard lists into the global top k (k ≤ LB_TOPK); returns entries written
+uint32_t lb_top_k(lb_entry_t *out, uint32_t k)
+{
+    lb_entry_t snap[LB_SHARDS][LB_TOPK];
+    uint32_t n[LB_SHARDS], pos[LB_SHARDS];
+    pthread_once(&g_lb_once, lb_init);
+    if (k > LB_TOPK)
+        k = LB_TOPK;
+    for (int i = 0; i < LB_SHARDS; ++i)
+    {
+        pthread_mutex_lock(&g_lb[i].topk_lock);
+        n[i] = g_lb[i].topk_n < k ? g_lb[i].topk_n : k;
+        memcpy(snap[i], g_lb[i].topk, n[i] * sizeof(lb_entry_t));
+        pthread_mutex_unlock(&g_lb[i].topk_lock);
+        pos[i] = 0;
     }
-       
-    pi1_7seg_show_ms("TOT", total);
-    pi3_uart_send_result(g_round_ix, g_random_wait_ms, g_visual_ms, g_tactile_ms, total, g_best_total_ms);
+    uint32_t w = 0;
+    while (w < k)
+    {
+        int pick = -1;
+        for (int i = 0; i < LB_SHARDS; ++i)
+        {
+            if (pos[i] == n[i])
+                continue;
+            const lb_entry_t *c = &snap[i][pos[i]];
+            if (pick < 0 || c->total_ms < snap[pick][pos[pick]].total_ms ||
+                (c->total_ms == snap[pick][pos[pick]].total_ms && c->player < snap[pick][pos[pick]].player))
+                pick = i;
+        }
+        if (pick < 0)
+            break;
+        out[w++] = snap[pick][pos[pick]++];
+    }
+    return w;
+}
 
-    // FEEDBACK if best improved — PI1 (LED) + optional buzzer later
-    if (g_score_improved)
+void lb_reset(void)
+{
+    pthread_once(&g_lb_once, lb_init);
+    memset(&g_pct, 0, sizeof(g_pct));
+    g_pct.dirty_block = PCT_BLOCKS;
+    memset(g_lb_best, 0, sizeof(g_lb_best));
+    for (int i = 0; i < LB_SHARDS; ++i)
     {
-        state_to_feedback();
-        printf("[PI1] BEST improved → LED blink + buzzer (mock)\n");
+        pthread_mutex_lock(&g_lb[i].topk_lock);
+        memset(g_lb[i].fen, 0, sizeof(g_lb[i].fen));
+        g_lb[i].topk_n = 0;
+        pthread_mutex_unlock(&g_lb[i].topk_lock);
     }
-    return;
+}
+
+// IDLE: warm the player's leaderboard slot before REPORT submits to it
+void lb_prefetch(uint32_t player)
+{
+    if (player == 0 || !g_profile_prefetch)
+        return;
+    __builtin_prefetch(&g_lb_best[player % PLAYER_STORE_CAPACITY], 1, 3);
+}
+
+// Pipeline stage: rank completed rounds of identified players, show their percentile
+void leaderboard_stage(rec_handle_t h)
+{
+    const round_rec_t *r = rec_get(h);
+    uint32_t prev;
+    if (r->cause == ABORT_NONE && r->player)
+    {
+        if (lb_submit(r->player, r->total_ms, &prev))
+            pct_move(&g_pct, prev, r->total_ms);
+        LOG("[PI1] 7SEG: faster than %u%% of players\n", pct_faster_than(&g_pct, r->total_ms));
+    }
+    rec_release(h);
 }
 
 /* =========================
-   main()
+   Round history (bit-packed, 8 B per round)
+   ========================= */
+
+// [11:0] wait  [22:12] visual  [33:23] tactile  [36:34] cause  [39:37] flags  [63:40] player
+typedef uint64_t packed_round_t;
+
+#define PR_WAIT_SHIFT 0
+#define PR_WAIT_BITS 12
+#define PR_VIS_SHIFT 12
+#define PR_VIS_BITS 11
+#define PR_TACT_SHIFT 23
+#define PR_TACT_BITS 11
+#define PR_CAUSE_SHIFT 34
+#define PR_CAUSE_BITS 3
+#define PR_FLAGS_SHIFT 37
+#define PR_FLAGS_BITS 3
+#define PR_PLAYER_SHIFT 40
+#define PR_PLAYER_BITS 24
+
+#define PR_MASK(bits) ((1u << (bits)) - 1u)
+#define PR_FIELD(p, f) ((uint32_t)((p) >> PR_##f##_SHIFT) & PR_MASK(PR_##f##_BITS))
+
+_Static_assert(RANDOM_WAIT_MAX_MS <= PR_MASK(PR_WAIT_BITS), "wait does not fit packed field");
+_Static_assert(VISUAL_WINDOW_MS <= PR_MASK(PR_VIS_BITS), "visual does not fit packed field");
+_Static_assert(TACTILE_WINDOW_MS <= PR_MASK(PR_TACT_BITS), "tactile does not fit packed field");
+
+static inline packed_round_t round_pack(const round_rec_t *r, uint32_t player)
+{
+    return ((packed_round_t)clamp(r->wait_ms, 0, PR_MASK(PR_WAIT_BITS)) << PR_WAIT_SHIFT) |
+           ((packed_round_t)clamp(r->vis_ms, 0, PR_MASK(PR_VIS_BITS)) << PR_VIS_SHIFT) |
+           ((packed_round_t)clamp(r->tact_ms, 0, PR_MASK(PR_TACT_BITS)) << PR_TACT_SHIFT) |
+           ((packed_round_t)(r->cause & PR_MASK(PR_CAUSE_BITS)) << PR_CAUSE_SHIFT) |
+           ((packed_round_t)(r->flags & PR_MASK(PR_FLAGS_BITS)) << PR_FLAGS_SHIFT) |
+           ((packed_round_t)(player & PR_MASK(PR_PLAYER_BITS)) << PR_PLAYER_SHIFT);
+}
+
+// Column-wise view filled by history_unpack_soa() (caller owns the arrays)
+typedef struct
+{
+    uint16_t *wait_ms;
+    uint16_t *vis_ms;
+    uint16_t *tact_ms;
+    uint8_t *cause;
+    uint8_t *flags;
+    uint32_t *player;
+} round_soa_t;
+
+// Ring of the newest HISTORY_CAPACITY rounds; oldest entries are overwritten
+typedef struct
+{
+    packed_round_t *slots;
+    size_t cap;
+    size_t head;  // next write position
+    size_t count; // valid entries (≤ cap)
+    uint64_t appended;
+} round_history_t;
+
+static packed_round_t g_history_buf[HISTORY_CAPACITY];
+static round_history_t g_history = {g_history_buf, HISTORY_CAPACITY, 0, 0, 0};
+
+static inline void history_append(round_history_t *hs, packed_round_t p)
+{
+    hs->slots[hs->head] = p;
+    if (++hs->head == hs->cap)
+        hs->head = 0;
+    if (hs->count < hs->cap)
+        hs->count++;
+    hs->appended++;
+}
+
+static void unpack_range(const packed_round_t *src, size_t n, const round_soa_t *out, size_t at)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        packed_round_t p = src[i];
+        out->wait_ms[at + i] = (uint16_t)PR_FIELD(p, WAIT);
+        out->vis_ms[at + i] = (uint16_t)PR_FIELD(p, VIS);
+        out->tact_ms[at + i] = (uint16_t)PR_FIELD(p, TACT);
+        out->cause[at + i] = (uint8_t)PR_FIELD(p, CAUSE);
+        out->flags[at + i] = (uint8_t)PR_FIELD(p, FLAGS);
+        out->player[at + i] = PR_FIELD(p, PLAYER);
+    }
+}
+
+// Unpack n rounds starting at logical index first (0 = oldest kept); returns rounds written
+size_t history_unpack_soa(const round_history_t *hs, size_t first, size_t n, const round_soa_t *out)
+{
+    if (first >= hs->count)
+        return 0;
+    if (n > hs->count - first)
+        n = hs->count - first;
+    size_t start = (hs->head + hs->cap - hs->count + first) % hs->cap;
+    size_t run = hs->cap - start < n ? hs->cap - start : n; // up to the ring wrap
+    unpack_range(hs->slots + start, run, out, 0);
+    unpack_range(hs->slots, n - run, out, run);
+    return n;
+}
+
+// Pipeline stage: keep the round in the in-memory history
+void history_stage(rec_handle_t h)
+{
+    const round_rec_t *r = rec_get(h);
+    history_append(&g_history, round_pack(r, r->player));
+    rec_release(h);
+}
+
+/* =========================
+   Results journal + per-player history index (chunk chains)
    ========================= */
-int main(void)
+#define JIDX_CHUNK_ENTRIES 62 // rounds per index chunk (chunk = 1 KiB)
+#define JOURNAL_SEAL_ROWS 65536 // active journal is sealed into <prefix>.journal.<seg> at this size
+
+// Journal row: append-only, 16 B
+typedef struct
+{
+    uint32_t seq;
+    uint32_t ts; // station clock, seconds
+    packed_round_t packed;
+} journal_rec_t;
+
+// Index chunk: one player's rounds in append order, chained newest → oldest.
+// skip jumps to the chunk whose ordinal has the lowest set bit cleared, so
+// seeking to a timestamp takes O(log n) chunk hops.
+typedef struct
+{
+    uint32_t player;
+    uint32_t prev;    // chunk id (1-based), 0 = none
+    uint32_t skip;    // chunk id, 0 = none
+    uint32_t ordinal; // 1-based position in this player's chain
+    uint32_t count;
+    uint32_t first_ts;
+    uint32_t last_ts;
+    uint32_t reserved;
+    journal_rec_t e[JIDX_CHUNK_ENTRIES];
+} jidx_chunk_t;
+
+#define JIDX_HDR_BYTES offsetof(jidx_chunk_t, e)
+_Static_assert(sizeof(jidx_chunk_t) == 1024, "index chunk must stay 1 KiB");
+
+typedef struct
+{
+    FILE *jf; // active rows: <prefix>.journal, or <prefix>.journal.next until the seal is rotated
+    FILE *xf; // <prefix>.jidx
+    _Atomic(FILE *) spare;  // pre-opened <prefix>.journal.next (rotator → appender)
+    _Atomic(FILE *) sealed; // full active file awaiting rotation (appender → rotator), NULL = none
+    char prefix[200];
+    uint32_t nchunks;
+    uint32_t active_rows;
+    _Atomic uint32_t next_seg;  // sealed row segments are 0 .. next_seg-1
+    _Atomic uint32_t compacted; // segments below this are columnar (<prefix>.col.<seg>)
+    uint64_t appended;
+} journal_t;
+
+static journal_t g_journal;
+static pthread_mutex_t g_manifest_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_rotate_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Persist next_seg/compacted via write-to-temp + rename (atomic swap on POSIX)
+static bool journal_write_manifest(journal_t *j)
+{
+    char path[256], tmp[264];
+    pthread_mutex_lock(&g_manifest_lock);
+    snprintf(path, sizeof(path), "%s.manifest", j->prefix);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    bool ok = f && fprintf(f, "next_seg %u\ncompacted %u\n", atomic_load(&j->next_seg), atomic_load(&j->compacted)) > 0;
+    if (f)
+        ok = (fclose(f) == 0) && ok;
+    ok = ok && rename(tmp, path) == 0;
+    pthread_mutex_unlock(&g_manifest_lock);
+    return ok;
+}
+
+// File-system half of a seal (compactor thread): the sealed rows become <prefix>.journal.<next_seg>, the
+// spare being appended to becomes <prefix>.journal, and a fresh spare is opened
+static bool journal_rotate(journal_t *j)
 {
+    char active[256], next[264], seg[272];
+    snprintf(active, sizeof(active), "%s.journal", j->prefix);
+    snprintf(next, sizeof(next), "%s.journal.next", j->prefix);
+    pthread_mutex_lock(&g_rotate_lock);
+    bool ok = true;
+    FILE *f = atomic_load(&j->sealed);
+    if (f)
+    {
+        snprintf(seg, sizeof(seg), "%s.journal.%u", j->prefix, atomic_load(&j->next_seg));
+        atomic_store(&j->sealed, NULL);
+        ok = fclose(f) == 0 && rename(active, seg) == 0 && rename(next, active) == 0;
+        if (ok)
+        {
+            atomic_fetch_add(&j->next_seg, 1);
+            ok = journal_write_manifest(j);
+        }
+    }
+    if (ok && !atomic_load(&j->spare))
+    {
+        FILE *sp = fopen(next, "wb");
+        atomic_store(&j->spare, sp);
+        ok = sp != NULL;
+    }
+    pthread_mutex_unlock(&g_rotate_lock);
+    return ok;
+}
+
+// Seal the active rows on the append path: switch to the pre-opened spare and leave the renames and the
+// manifest to the compactor. Only when the previous seal is still unrotated (no compactor running, or one
+// a whole segment behind) does the append rotate inline.
+static bool journal_seal(journal_t *j)
+{
+    if (atomic_load(&j->sealed) && !journal_rotate(j))
+        return false;
+    FILE *sp = atomic_exchange(&j->spare, NULL);
+    if (!sp && (!journal_rotate(j) || !(sp = atomic_exchange(&j->spare, NULL))))
+        return false;
+    fflush(j->jf); // sealed rows readable by name before the rotation
+    atomic_store(&j->sealed, j->jf);
+    j->jf = sp;
+    j->active_rows = 0;
+    return true;
+}
+#define JIDX_PROBE_MAX 64 // linear probes in the head table
+
+typedef struct
+{
+    uint32_t player;
+    uint32_t head; // newest chunk id, 0 = empty slot
+} jidx_head_t;
+
+static jidx_head_t g_jidx_head[PLAYER_STORE_CAPACITY]; // open-addressed by full player id (rebuilt on open)
+
+// Player's head slot; claim = take an empty slot if it has none. NULL if absent (or table full around it)
+static jidx_head_t *jidx_head(uint32_t player, bool claim)
+{
+    for (uint32_t i = 0; i < JIDX_PROBE_MAX; ++i)
+    {
+        jidx_head_t *h = &g_jidx_head[(player + i) % PLAYER_STORE_CAPACITY];
+        if (h->head && h->player == player)
+            return h;
+        if (!h->head)
+        {
+            if (!claim)
+                return NULL;
+            h->player = player;
+            return h;
+        }
+    }
+    return NULL;
+}
+
+static bool jidx_read_hdr(journal_t *j, uint32_t id, jidx_chunk_t *c)
+{
+    return fseek(j->xf, (long)(id - 1) * (long)sizeof(jidx_chunk_t), SEEK_SET) == 0 &&
+           fread(c, JIDX_HDR_BYTES, 1, j->xf) == 1;
+}
+
+static bool jidx_read_chunk(journal_t *j, uint32_t id, jidx_chunk_t *c)
+{
+    return fseek(j->xf, (long)(id - 1) * (long)sizeof(jidx_chunk_t), SEEK_SET) == 0 &&
+           fread(c, sizeof(*c), 1, j->xf) == 1;
+}
+
+// Open (or create) a journal and its index; returns false on I/O failure
+bool journal_open(journal_t *j, const char *prefix)
+{
+    char path[256];
+    unsigned next_seg = 0, compacted = 0;
+    memset(j, 0, sizeof(*j));
+    snprintf(j->prefix, sizeof(j->prefix), "%s", prefix);
+    snprintf(path, sizeof(path), "%s.manifest", prefix);
+    FILE *mf = fopen(path, "r");
+    if (mf)
+    {
+        if (fscanf(mf, "next_seg %u compacted %u", &next_seg, &compacted) != 2)
+            next_seg = compacted = 0;
+        fclose(mf);
+    }
+
+    // finish a rotation a crash cut short: rows in a non-empty spare are newer than <prefix>.journal
+    char active[256], next[264], seg[272];
+    snprintf(active, sizeof(active), "%s.journal", prefix);
+    snprintf(next, sizeof(next), "%s.journal.next", prefix);
+    unsigned seg0 = next_seg;
+    FILE *nf = fopen(next, "rb");
+    bool spare_rows = nf && fseek(nf, 0, SEEK_END) == 0 && ftell(nf) > 0;
+    if (nf)
+        fclose(nf);
+    for (;; ++next_seg) // sealed segments renamed before the manifest was written
+    {
+        snprintf(seg, sizeof(seg), "%s.journal.%u", prefix, next_seg);
+        FILE *sf = fopen(seg, "rb");
+        if (!sf)
+            break;
+        fclose(sf);
+    }
+    if (spare_rows)
+    {
+        if (rename(active, seg) == 0)
+            next_seg++;
+        rename(next, active);
+    }
+    atomic_store(&j->next_seg, next_seg);
+    atomic_store(&j->compacted, compacted);
+    if (next_seg != seg0)
+        journal_write_manifest(j);
+    j->jf = fopen(active, "ab");
+    snprintf(path, sizeof(path), "%s.jidx", prefix);
+    j->xf = fopen(path, "r+b");
+    if (!j->xf)
+        j->xf = fopen(path, "w+b");
+    if (!j->jf || !j->xf || !journal_rotate(j)) // rotate opens the spare
+    {
+        if (j->jf)
+            fclose(j->jf);
+        if (j->xf)
+            fclose(j->xf);
+        j->jf = j->xf = NULL;
+        return false;
+    }
+
+    fseek(j->jf, 0, SEEK_END);
+    j->active_rows = (uint32_t)(ftell(j->jf) / (long)sizeof(journal_rec_t));
+
+    // chunk ids grow with time, so the last chunk seen for a player is its head
+    memset(g_jidx_head, 0, sizeof(g_jidx_head));
+    jidx_chunk_t c;
+    for (uint32_t id = 1; jidx_read_hdr(j, id, &c); ++id)
+    {
+        jidx_head_t *h = jidx_head(c.player, true);
+        if (h)
+            h->head = id;
+        j->nchunks = id;
+    }
+    return true;
+}
+
+void journal_close(journal_t *j)
+{
+    char next[264];
+    if (j->jf)
+        journal_rotate(j); // a pending seal is finished, so every sealed row is in a numbered segment
+    FILE *sp = atomic_exchange(&j->spare, NULL);
+    if (sp)
+    {
+        fclose(sp);
+        snprintf(next, sizeof(next), "%s.journal.next", j->prefix);
+        remove(next);
+    }
+    if (j->jf)
+        fclose(j->jf);
+    if (j->xf)
+        fclose(j->xf);
+    j->jf = j->xf = NULL;
+}
+
+// Append one round to the journal and to the chunk chain of player (the full id: the row's packed PLAYER
+// field keeps only its low PR_PLAYER_BITS, so chains are never keyed by it)
+bool journal_append(journal_t *j, uint32_t seq, uint32_t ts, uint32_t player, packed_round_t packed)
+{
+    journal_rec_t rec = {seq, ts, packed};
+    if (fwrite(&rec, sizeof(rec), 1, j->jf) != 1)
+        return false;
+    j->appended++;
+    if (++j->active_rows >= JOURNAL_SEAL_ROWS && !journal_seal(j))
+        return false;
+
+    jidx_head_t *h = jidx_head(player, true);
+    if (!h)
+        return false;
+    uint32_t id = h->head;
+    jidx_chunk_t c;
+    if (id && !jidx_read_hdr(j, id, &c))
+        return false;
+    if (id == 0 || c.count == JIDX_CHUNK_ENTRIES)
+    {
+        jidx_chunk_t prev;
+        uint32_t ord = id ? c.ordinal + 1 : 1;
+        uint32_t target = ord & (ord - 1); // ordinal of the skip chunk
+        uint32_t skip = id;
+        while (skip && jidx_read_hdr(j, skip, &prev) && prev.ordinal > target)
+        {
+            jidx_chunk_t sk;
+            skip = (prev.skip && jidx_read_hdr(j, prev.skip, &sk) && sk.ordinal >= target) ? prev.skip : prev.prev;
+        }
+        memset(&c, 0, sizeof(c));
+        c.player = player;
+        c.prev = id;
+        c.skip = target ? skip : 0;
+        c.ordinal = ord;
+        c.first_ts = ts;
+        id = ++j->nchunks;
+        h->head = id;
+        // reserve the whole chunk so the file stays a dense array of chunks
+        if (fseek(j->xf, (long)(id - 1) * (long)sizeof(jidx_chunk_t), SEEK_SET) != 0 ||
+            fwrite(&c, sizeof(c), 1, j->xf) != 1)
+            return false;
+    }
+
+    long base = (long)(id - 1) * (long)sizeof(jidx_chunk_t);
+    c.last_ts = ts;
+    if (fseek(j->xf, base + (long)JIDX_HDR_BYTES + (long)(c.count * sizeof(rec)), SEEK_SET) != 0 ||
+        fwrite(&rec, sizeof(rec), 1, j->xf) != 1)
+        return false;
+    c.count++;
+    return fseek(j->xf, base, SEEK_SET) == 0 && fwrite(&c, JIDX_HDR_BYTES, 1, j->xf) == 1;
+}
+
+// Player's rounds with t0 ≤ ts ≤ t1, newest first, at most max; O(log n + k) chunk reads
+size_t journal_query(journal_t *j, uint32_t player, uint32_t t0, uint32_t t1, journal_rec_t *out, size_t max)
+{
+    const jidx_head_t *h = jidx_head(player, false);
+    uint32_t id = h ? h->head : 0;
+    jidx_chunk_t c, sk;
+    size_t n = 0;
+
+    fflush(j->xf);
+    // seek: newest chunk that starts at or before t1
+    while (id && jidx_read_hdr(j, id, &c) && c.first_ts > t1)
+        id = (c.skip && jidx_read_hdr(j, c.skip, &sk) && sk.first_ts > t1) ? c.skip : c.prev;
+
+    // scan: whole chunks, newest to oldest
+    while (id && n < max && jidx_read_chunk(j, id, &c) && c.last_ts >= t0)
+    {
+        for (uint32_t i = c.count; i > 0 && n < max; --i)
+        {
+            const journal_rec_t *r = &c.e[i - 1];
+            if (r->ts < t0)
+                break;
+            if (r->ts <= t1)
+                out[n++] = *r;
+        }
+        id = c.prev;
+    }
+    return n;
+}
+
+/* =========================
+   Journal compaction (background; sealed rows → columnar segments)
+   ========================= */
+#define COLSEG_COLS 7
+#define COMPACT_BATCH_ROWS 4096          // rows encoded between throttle checks
+#define COMPACT_ROWS_PER_SEC 4000000u    // background budget
+#define COMPACT_BACKOFF_US 200           // wait while foreground work is in flight
+#define COMPACT_BACKOFF_MAX_US 2000      // behind: longest yield to foreground per batch
+#define COMPACT_BEHIND_SEGS 1            // sealed segments queued beyond this → catch up unpaced
+
+enum
+{
+    COL_SEQ = 0,
+    COL_TS,
+    COL_WAIT,
+    COL_VIS,
+    COL_TACT,
+    COL_META, // cause | flags << 3
+    COL_PLAYER
+};
+
+// Column segment header; each column is frame-of-reference bit-packed after it.
+// seq/ts are stored as zigzag deltas from the previous row (first value in first[]).
+typedef struct
+{
+    char magic[4]; // "RCOL"
+    uint32_t rows;
+    uint32_t min[COLSEG_COLS]; // zone map
+    uint32_t max[COLSEG_COLS];
+    uint32_t first[COLSEG_COLS];
+    uint32_t base[COLSEG_COLS]; // FOR base of the stored values
+    uint32_t bits[COLSEG_COLS];
+    uint32_t words[COLSEG_COLS]; // uint64 words per column
+} colseg_hdr_t;
+
+#define COLSEG_DELTA_COLS ((1u << COL_SEQ) | (1u << COL_TS))
+
+// Foreground (REPORT path, hub ingest) in flight; compaction backs off while > 0
+static _Atomic uint32_t g_fg_busy = 0;
+
+static void sleep_us(uint32_t us)
+{
+    struct timespec ts = {(time_t)(us / 1000000u), (long)(us % 1000000u) * 1000L};
+    nanosleep(&ts, NULL);
+}
+
+static inline uint32_t colseg_value(const journal_rec_t *r, int col)
+{
+    switch (col)
+    {
+    case COL_SEQ: return r->seq;
+    case COL_TS: return r->ts;
+    case COL_WAIT: return PR_FIELD(r->packed, WAIT);
+    case COL_VIS: return PR_FIELD(r->packed, VIS);
+    case COL_TACT: return PR_FIELD(r->packed, TACT);
+    case COL_META: return PR_FIELD(r->packed, CAUSE) | PR_FIELD(r->packed, FLAGS) << PR_CAUSE_BITS;
+    default: return PR_FIELD(r->packed, PLAYER);
+    }
+}
+
+// Zone-map check: can this segment hold rows with t0 ≤ ts ≤ t1?
+static inline bool colseg_may_contain(const colseg_hdr_t *h, uint32_t t0, uint32_t t1)
+{
+    return h->rows && h->min[COL_TS] <= t1 && h->max[COL_TS] >= t0;
+}
+
+static journal_rec_t g_compact_rows[JOURNAL_SEAL_ROWS];
+static uint32_t g_compact_vals[JOURNAL_SEAL_ROWS];
+static uint64_t g_compact_words[(JOURNAL_SEAL_ROWS * 32u) / 64u];
+
+// Pace the compactor: rate budget, and yield whenever foreground work is running.
+// Behind, the yield is bounded and the budget skipped, so a foreground that is never idle cannot starve it.
+static void compact_throttle(double t_start, uint64_t rows_done, bool behind)
+{
+    for (uint32_t waited = 0; atomic_load_explicit(&g_fg_busy, memory_order_relaxed) > 0; waited += COMPACT_BACKOFF_US)
+    {
+        if (behind && waited >= COMPACT_BACKOFF_MAX_US)
+            return;
+        sleep_us(COMPACT_BACKOFF_US);
+    }
+    if (behind)
+        return;
+    double ahead = (double)rows_done / COMPACT_ROWS_PER_SEC - (wall_now_s() - t_start);
+    if (ahead > 0)
+        sleep_us((uint32_t)(ahead * 1e6));
+}
+
+// Encode sealed row segment seg as <prefix>.col.<seg>; the swap is tmp + rename
+static bool compact_segment(journal_t *j, uint32_t seg, bool behind, uint64_t *bytes_in, uint64_t *bytes_out)
+{
+    char src[272], dst[272], tmp[280];
+    colseg_hdr_t h;
+    double t0 = wall_now_s();
+    snprintf(src, sizeof(src), "%s.journal.%u", j->prefix, seg);
+    snprintf(dst, sizeof(dst), "%s.col.%u", j->prefix, seg);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", dst);
+
+    FILE *in = fopen(src, "rb");
+    if (!in)
+        return false;
+    uint32_t rows = 0;
+    size_t n;
+    while (rows < JOURNAL_SEAL_ROWS &&
+           (n = fread(g_compact_rows + rows, sizeof(journal_rec_t), COMPACT_BATCH_ROWS, in)) > 0)
+    {
+        rows += (uint32_t)n;
+        compact_throttle(t0, rows, behind);
+    }
+    fclose(in);
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "RCOL", 4);
+    h.rows = rows;
+    FILE *out = fopen(tmp, "wb");
+    bool ok = out && fwrite(&h, sizeof(h), 1, out) == 1; // placeholder, rewritten below
+    for (int c = 0; ok && c < COLSEG_COLS; ++c)
+    {
+        uint32_t prev = rows ? colseg_value(&g_compact_rows[0], c) : 0, lo = 0xFFFFFFFF, hi = 0;
+        h.first[c] = prev;
+        h.min[c] = 0xFFFFFFFF;
+        for (uint32_t i = 0; i < rows; ++i)
+        {
+            uint32_t v = colseg_value(&g_compact_rows[i], c);
+            h.min[c] = v < h.min[c] ? v : h.min[c];
+            h.max[c] = v > h.max[c] ? v : h.max[c];
+            if (COLSEG_DELTA_COLS & (1u << c))
+            {
+                int32_t d = (int32_t)(v - prev);
+                prev = v;
+                v = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31); // zigzag
+            }
+            g_compact_vals[i] = v;
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+        }
+        uint32_t span = rows ? hi - lo : 0;
+        h.base[c] = rows ? lo : 0;
+        h.bits[c] = span ? 32u - (uint32_t)__builtin_clz(span) : 0;
+        h.words[c] = (uint32_t)(((uint64_t)rows * h.bits[c] + 63) / 64);
+
+        memset(g_compact_words, 0, h.words[c] * sizeof(uint64_t));
+        for (uint32_t i = 0; i < rows && h.bits[c]; ++i)
+        {
+            uint64_t v = g_compact_vals[i] - h.base[c];
+            uint64_t bit = (uint64_t)i * h.bits[c];
+            g_compact_words[bit / 64] |= v << (bit % 64);
+            if (bit % 64 + h.bits[c] > 64)
+                g_compact_words[bit / 64 + 1] |= v >> (64 - bit % 64);
+            if (i % COMPACT_BATCH_ROWS == COMPACT_BATCH_ROWS - 1)
+                compact_throttle(t0, rows, behind);
+        }
+        ok = fwrite(g_compact_words, sizeof(uint64_t), h.words[c], out) == h.words[c];
+    }
+    ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, out) == 1;
+    if (out)
+        ok = (fclose(out) == 0) && ok;
+    if (!ok || rename(tmp, dst) != 0)
+    {
+        remove(tmp);
+        return false;
+    }
+    *bytes_in += (uint64_t)rows * sizeof(journal_rec_t);
+    *bytes_out += sizeof(h);
+    for (int c = 0; c < COLSEG_COLS; ++c)
+        *bytes_out += (uint64_t)h.words[c] * sizeof(uint64_t);
+    return true;
+}
+
+// Decode one column of a column segment (out must hold h->rows values; words is
+// the caller's bit-packed scratch, JOURNAL_SEAL_ROWS / 2 words)
+bool colseg_read_column(const char *path, int col, colseg_hdr_t *h, uint32_t *out, uint64_t *words)
+{
+    FILE *f = fopen(path, "rb");
+    bool ok = f && fread(h, sizeof(*h), 1, f) == 1 && memcmp(h->magic, "RCOL", 4) == 0;
+    long off = (long)sizeof(*h);
+    for (int c = 0; ok && c < col; ++c)
+        off += (long)h->words[c] * (long)sizeof(uint64_t);
+    ok = ok && fseek(f, off, SEEK_SET) == 0 &&
+         fread(words, sizeof(uint64_t), h->words[col], f) == h->words[col];
+    if (f)
+        fclose(f);
+    uint32_t prev = h->first[col];
+    for (uint32_t i = 0; ok && i < h->rows; ++i)
+    {
+        uint64_t v = 0, bit = (uint64_t)i * h->bits[col];
+        if (h->bits[col])
+        {
+            v = words[bit / 64] >> (bit % 64);
+            if (bit % 64 + h->bits[col] > 64)
+                v |= words[bit / 64 + 1] << (64 - bit % 64);
+            v &= (1ull << h->bits[col]) - 1;
+        }
+        uint32_t s = h->base[col] + (uint32_t)v;
+        if (COLSEG_DELTA_COLS & (1u << col))
+            s = prev += (s >> 1) ^ (0u - (s & 1u)); // un-zigzag, then running sum
+        out[i] = s;
+    }
+    return ok;
+}
+
+typedef struct
+{
+    journal_t *j;
+    _Atomic bool stop;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint32_t segments;
+} compactor_t;
+
+// Background thread: batch scheduling class, rotates seals off the append path and compacts sealed segments
+// in order.
+// SCHED_BATCH never preempts the foreground on wakeup but keeps a normal CPU share; SCHED_IDLE starved it
+// behind a busy foreground, and an unprivileged thread cannot leave SCHED_IDLE once it falls behind.
+static void *compactor_main(void *arg)
+{
+    compactor_t *cp = (compactor_t *)arg;
+    journal_t *j = cp->j;
+#ifdef SCHED_BATCH
+    struct sched_param sp = {0};
+    pthread_setschedparam(pthread_self(), SCHED_BATCH, &sp);
+#endif
+    for (;;)
+    {
+        if (atomic_load(&j->sealed) && !journal_rotate(j))
+            break;
+        uint32_t seg = atomic_load(&j->compacted);
+        if (seg >= atomic_load(&j->next_seg))
+        {
+            if (atomic_load(&cp->stop))
+                break;
+            sleep_us(10000);
+            continue;
+        }
+        bool behind = atomic_load(&j->next_seg) - seg > COMPACT_BEHIND_SEGS;
+        if (!compact_segment(j, seg, behind, &cp->bytes_in, &cp->bytes_out))
+            break;
+        atomic_store(&j->compacted, seg + 1);
+        if (!journal_write_manifest(j))
+            break;
+        char src[272];
+        snprintf(src, sizeof(src), "%s.journal.%u", j->prefix, seg);
+        remove(src); // readers switch to the column file via the manifest first
+        cp->segments++;
+    }
+    return NULL;
+}
+
+/* =========================
+   Hub ingest (exactly-once per station sequence)
+   ========================= */
+#define HUB_MAX_STATIONS 256
+#define HUB_WINDOW_BITS 4096 // dedupe window per station (power of 2)
+#define HUB_GAP_SLOTS 32     // outstanding resend requests per station
+#define HUB_RESEND_EVERY 1024 // frames between resend rounds (keep < HUB_WINDOW_BITS)
+
+// One frame as decoded at the hub
+typedef struct
+{
+    uint16_t station;
+    uint32_t seq;
+    packed_round_t packed;
+} hub_frame_t;
+
+typedef enum
+{
+    HUB_ACCEPT = 0,
+    HUB_DUP,   // seen already (retransmission)
+    HUB_STALE  // older than the window; treated as already delivered
+} hub_verdict_t;
+
+typedef struct
+{
+    uint32_t from;
+    uint32_t to; // inclusive
+} hub_gap_t;
+
+typedef struct
+{
+    uint32_t hi; // highest accepted seq (0 = none yet)
+    uint64_t seen[HUB_WINDOW_BITS / 64]; // bit (seq % HUB_WINDOW_BITS) for seqs in (hi - W, hi]
+    hub_gap_t gaps[HUB_GAP_SLOTS];
+    uint32_t ngaps;
+    uint64_t accepted, dups, stale, gap_frames;
+} hub_station_t;
+
+static hub_station_t g_hub[HUB_MAX_STATIONS];
+
+static inline bool hub_bit(const hub_station_t *st, uint32_t seq)
+{
+    return (st->seen[(seq % HUB_WINDOW_BITS) / 64] >> (seq % 64)) & 1u;
+}
+
+static inline void hub_set_bit(hub_station_t *st, uint32_t seq)
+{
+    st->seen[(seq % HUB_WINDOW_BITS) / 64] |= 1ull << (seq % 64);
+}
+
+// Gap detector: remember a missing seq range for a bulk resend request
+static void hub_note_gap(hub_station_t *st, uint32_t from, uint32_t to)
+{
+    st->gap_frames += to - from + 1;
+    if (st->ngaps < HUB_GAP_SLOTS)
+        st->gaps[st->ngaps++] = (hub_gap_t){from, to};
+    else
+        st->gaps[HUB_GAP_SLOTS - 1].to = to; // coalesce into the last request
+}
+
+// O(1) amortized exactly-once check; accepted seqs are marked in the window
+hub_verdict_t hub_seq_check(uint16_t station, uint32_t seq)
+{
+    hub_station_t *st = &g_hub[station % HUB_MAX_STATIONS];
+    if (seq > st->hi)
+    {
+        if (seq > st->hi + 1)
+            hub_note_gap(st, st->hi + 1, seq - 1);
+        // slide: clear the bits of seqs that newly enter the window
+        uint32_t span = seq - st->hi;
+        if (span >= HUB_WINDOW_BITS)
+            memset(st->seen, 0, sizeof(st->seen));
+        else
+            for (uint32_t s = st->hi + 1; s <= seq; ++s)
+                if (s % 64 == 0 && seq - s >= 63)
+                    st->seen[(s % HUB_WINDOW_BITS) / 64] = 0, s += 63;
+                else
+                    st->seen[(s % HUB_WINDOW_BITS) / 64] &= ~(1ull << (s % 64));
+        st->hi = seq;
+        hub_set_bit(st, seq);
+        st->accepted++;
+        return HUB_ACCEPT;
+    }
+    if (st->hi - seq >= HUB_WINDOW_BITS)
+    {
+        st->stale++;
+        return HUB_STALE;
+    }
+    if (hub_bit(st, seq))
+    {
+        st->dups++;
+        return HUB_DUP;
+    }
+    hub_set_bit(st, seq); // late frame or resend filling a gap
+    st->accepted++;
+    return HUB_ACCEPT;
+}
+
+// Aggregate an accepted round (leaderboard, percentile)
+static void hub_aggregate(const hub_frame_t *f)
+{
+    uint32_t player = PR_FIELD(f->packed, PLAYER), prev;
+    uint32_t total = PR_FIELD(f->packed, VIS) + PR_FIELD(f->packed, TACT);
+    if (PR_FIELD(f->packed, CAUSE) == ABORT_NONE && lb_submit(player, total, &prev))
+        pct_move(&g_pct, prev, total);
+}
+
+// Returns true when the frame was new and has been aggregated
+bool hub_ingest(const hub_frame_t *f)
+{
+    if (hub_seq_check(f->station, f->seq) != HUB_ACCEPT)
+        return false;
+    hub_aggregate(f);
+    return true;
+}
+
+// Bulk history path: replay journal rows with from ≤ seq ≤ to (row segments, binary search by seq)
+static size_t journal_resend_file(const char *path, uint16_t station, uint32_t from, uint32_t to)
+{
+    FILE *f = fopen(path, "rb");
+    journal_rec_t rec;
+    size_t sent = 0;
+    if (!f)
+        return 0;
+    fseek(f, 0, SEEK_END);
+    long lo = 0, hi = ftell(f) / (long)sizeof(rec);
+    while (lo < hi) // rows are appended in seq order
+    {
+        long mid = (lo + hi) / 2;
+        if (fseek(f, mid * (long)sizeof(rec), SEEK_SET) != 0 || fread(&rec, sizeof(rec), 1, f) != 1)
+            break;
+        if (rec.seq < from)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    fseek(f, lo * (long)sizeof(rec), SEEK_SET);
+    while (fread(&rec, sizeof(rec), 1, f) == 1 && rec.seq <= to)
+    {
+        hub_frame_t fr = {station, rec.seq, rec.packed};
+        hub_ingest(&fr);
+        sent++;
+    }
+    fclose(f);
+    return sent;
+}
+
+static uint32_t g_resend_cols[COLSEG_COLS][JOURNAL_SEAL_ROWS]; // resend decode (the compactor owns g_compact_*)
+static uint64_t g_resend_words[(JOURNAL_SEAL_ROWS * 32u) / 64u];
+
+// Same for a compacted segment: seq zone map first, then decode the columns and rebuild the rows
+static size_t colseg_resend_file(const char *path, uint16_t station, uint32_t from, uint32_t to)
+{
+    colseg_hdr_t h;
+    FILE *f = fopen(path, "rb");
+    bool ok = f && fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, "RCOL", 4) == 0;
+    if (f)
+        fclose(f);
+    if (!ok || !h.rows || h.min[COL_SEQ] > to || h.max[COL_SEQ] < from)
+        return 0;
+    for (int c = 0; ok && c < COLSEG_COLS; ++c)
+        ok = colseg_read_column(path, c, &h, g_resend_cols[c], g_resend_words);
+    size_t sent = 0;
+    for (uint32_t i = 0; ok && i < h.rows; ++i)
+    {
+        uint32_t seq = g_resend_cols[COL_SEQ][i], meta = g_resend_cols[COL_META][i];
+        if (seq < from || seq > to)
+            continue;
+        packed_round_t p = ((packed_round_t)g_resend_cols[COL_WAIT][i] << PR_WAIT_SHIFT) |
+                           ((packed_round_t)g_resend_cols[COL_VIS][i] << PR_VIS_SHIFT) |
+                           ((packed_round_t)g_resend_cols[COL_TACT][i] << PR_TACT_SHIFT) |
+                           ((packed_round_t)(meta & PR_MASK(PR_CAUSE_BITS)) << PR_CAUSE_SHIFT) |
+                           ((packed_round_t)(meta >> PR_CAUSE_BITS) << PR_FLAGS_SHIFT) |
+                           ((packed_round_t)g_resend_cols[COL_PLAYER][i] << PR_PLAYER_SHIFT);
+        hub_frame_t fr = {station, seq, p};
+        hub_ingest(&fr);
+        sent++;
+    }
+    return sent;
+}
+
+// Serve a station's outstanding gaps from its journal (column segments, sealed rows, active rows and spare).
+// A gap stays outstanding until every seq in it was found, e.g. while a segment is being swapped
+size_t hub_resend_gaps(uint16_t station, journal_t *j)
+{
+    hub_station_t *st = &g_hub[station % HUB_MAX_STATIONS];
+    char path[272];
+    size_t sent = 0;
+    uint32_t kept = 0;
+    fflush(j->jf);
+    for (uint32_t g = 0; g < st->ngaps; ++g)
+    {
+        hub_gap_t gap = st->gaps[g];
+        size_t found = 0;
+        uint32_t compacted = atomic_load(&j->compacted);
+        for (uint32_t seg = 0; seg < compacted; ++seg)
+        {
+            snprintf(path, sizeof(path), "%s.col.%u", j->prefix, seg);
+            found += colseg_resend_file(path, station, gap.from, gap.to);
+        }
+        for (uint32_t seg = compacted; seg < atomic_load(&j->next_seg); ++seg)
+        {
+            snprintf(path, sizeof(path), "%s.journal.%u", j->prefix, seg);
+            found += journal_resend_file(path, station, gap.from, gap.to);
+        }
+        snprintf(path, sizeof(path), "%s.journal", j->prefix);
+        found += journal_resend_file(path, station, gap.from, gap.to);
+        snprintf(path, sizeof(path), "%s.journal.next", j->prefix); // newest rows while a seal awaits rotation
+        found += journal_resend_file(path, station, gap.from, gap.to);
+        sent += found;
+        if (found < (size_t)(gap.to - gap.from) + 1)
+            st->gaps[kept++] = gap;
+    }
+    st->ngaps = kept;
+    return sent;
+}
+
+void hub_reset(void)
+{
+    memset(g_hub, 0, sizeof(g_hub));
+}
+
+/* =========================
+   MPSC ingest queue (hub reader threads → aggregator)
+   ========================= */
+#define MPSC_CAPACITY 4096 // slots (power of 2)
+#define MPSC_BATCH 64      // max records per batch dequeue
+
+// One cache line per slot; seq == pos + 1 marks it full for position pos
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t seq;
+    hub_frame_t f;
+    uint64_t t_enq; // cycles_now() at push (latency accounting)
+} mpsc_slot_t;
+
+_Static_assert(sizeof(mpsc_slot_t) == 64, "queue slot must fill exactly one cache line");
+
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t tail; // producers claim positions here
+    _Alignas(64) uint64_t head;         // consumer only
+    mpsc_slot_t slots[MPSC_CAPACITY];
+} mpsc_queue_t;
+
+void mpsc_init(mpsc_queue_t *q)
+{
+    atomic_store(&q->tail, 0);
+    q->head = 0;
+    for (uint64_t i = 0; i < MPSC_CAPACITY; ++i)
+        atomic_store_explicit(&q->slots[i].seq, i, memory_order_relaxed);
+}
+
+// Returns false when the queue is full (caller decides to retry or drop)
+bool mpsc_push(mpsc_queue_t *q, const hub_frame_t *f)
+{
+    uint64_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    for (;;)
+    {
+        mpsc_slot_t *sl = &q->slots[pos & (MPSC_CAPACITY - 1)];
+        int64_t dif = (int64_t)atomic_load_explicit(&sl->seq, memory_order_acquire) - (int64_t)pos;
+        if (dif == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+            {
+                sl->f = *f;
+                sl->t_enq = cycles_now();
+                atomic_store_explicit(&sl->seq, pos + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (dif < 0)
+            return false;
+        else
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    }
+}
+
+// Take up to max contiguous ready records; slots are handed back to producers after the copy
+size_t mpsc_pop_batch(mpsc_queue_t *q, hub_frame_t *out, uint64_t *t_enq, size_t max)
+{
+    size_t n = 0;
+    while (n < max)
+    {
+        mpsc_slot_t *sl = &q->slots[(q->head + n) & (MPSC_CAPACITY - 1)];
+        if (atomic_load_explicit(&sl->seq, memory_order_acquire) != q->head + n + 1)
+            break;
+        out[n] = sl->f;
+        if (t_enq)
+            t_enq[n] = sl->t_enq;
+        ++n;
+    }
+    for (size_t i = 0; i < n; ++i)
+        atomic_store_explicit(&q->slots[(q->head + i) & (MPSC_CAPACITY - 1)].seq, q->head + i + MPSC_CAPACITY,
+                              memory_order_release);
+    q->head += n;
+    return n;
+}
+
+// Pipeline stage: persist every published round when a journal is open
+void journal_stage(rec_handle_t h)
+{
+    const round_rec_t *r = rec_get(h);
+    if (g_journal.jf)
+        journal_append(&g_journal, r->seq, (uint32_t)time(NULL), r->player, round_pack(r, r->player));
+    rec_release(h);
+}
+
+/* =========================
+   Round statistics (per-thread shards, merged lazily on read)
+   ========================= */
+#define STATS_SHARDS 64                                 // ≥ writer threads (one per core when pinned)
+#define STATS_HIST_BIN_MS 10                            // total-time histogram bin width
+#define STATS_HIST_BINS (LB_MAX_TOTAL_MS / STATS_HIST_BIN_MS + 1)
+#define ABORT_CAUSES (ABORT_TACT_TIMEOUT + 1)           // abort_cause_t values
+
+// Written by one thread with relaxed atomic loads/stores (plain movs, no RMW); readers take a seqlock
+// snapshot (seq odd = write in progress)
+typedef struct
+{
+    _Alignas(64) _Atomic uint32_t seq;
+    _Atomic uint64_t rounds, bests, glitches;
+    _Atomic uint64_t aborts[ABORT_CAUSES];
+    _Atomic uint32_t best_ms;
+    _Atomic uint64_t sum, sumsq; // completed-round totals (exact; merged by addition)
+    _Atomic uint32_t hist[STATS_HIST_BINS];
+} stats_shard_t;
+
+// One shard's counters as read under the seqlock
+typedef struct
+{
+    uint64_t rounds, bests, glitches;
+    uint64_t aborts[ABORT_CAUSES];
+    uint32_t best_ms;
+    uint64_t sum, sumsq;
+    uint32_t hist[STATS_HIST_BINS];
+} stats_counts_t;
+
+#define STATS_LD(f) atomic_load_explicit(&(f), memory_order_relaxed)
+#define STATS_ST(f, v) atomic_store_explicit(&(f), (v), memory_order_relaxed)
+#define STATS_ADD(f, d) STATS_ST(f, STATS_LD(f) + (d)) // shard owner (or overflow lock holder) only
+
+typedef struct
+{
+    stats_shard_t shard[STATS_SHARDS];
+} stats_t;
+
+// Merged view (what a single global counter set would hold)
+typedef struct
+{
+    uint64_t rounds, bests, glitches;
+    uint64_t aborts[ABORT_CAUSES];
+    uint32_t best_ms;
+    double mean, var;
+    uint32_t hist[STATS_HIST_BINS];
+} stats_view_t;
+
+#define STATS_OVERFLOW (STATS_SHARDS - 1) // shared by threads beyond the owned shards (CAS on seq)
+
+static stats_t g_stats;
+static _Atomic uint64_t g_stats_owned; // bit i: shard i owned by a live thread
+static pthread_key_t g_stats_key;
+static pthread_once_t g_stats_once = PTHREAD_ONCE_INIT;
+static __thread int32_t t_stats_shard = -1;
+
+_Static_assert(STATS_SHARDS <= 64, "owned-shard bitmap is one word");
+
+void stats_reset(stats_t *st)
+{
+    for (uint32_t i = 0; i < STATS_SHARDS; ++i)
+    {
+        memset(&st->shard[i], 0, sizeof(stats_shard_t));
+        st->shard[i].best_ms = 0xFFFFFFFF;
+    }
+}
+
+// Thread exit: hand the shard (and its counts) to the next thread that claims one
+static void stats_release_shard(void *v)
+{
+    uint32_t i = (uint32_t)(uintptr_t)v - 1;
+    atomic_fetch_and(&g_stats_owned, ~(1ull << i));
+}
+
+static void stats_key_init(void)
+{
+    pthread_key_create(&g_stats_key, stats_release_shard);
+}
+
+// First write of a thread: claim a free shard, or fall back to the shared overflow shard
+static void stats_claim(void)
+{
+    pthread_once(&g_stats_once, stats_key_init);
+    uint64_t owned = atomic_load(&g_stats_owned);
+    for (uint32_t i = 0; i < STATS_OVERFLOW; ++i)
+    {
+        if ((owned >> i) & 1u)
+            continue;
+        if (atomic_compare_exchange_strong(&g_stats_owned, &owned, owned | (1ull << i)))
+        {
+            t_stats_shard = (int32_t)i;
+            pthread_setspecific(g_stats_key, (void *)(uintptr_t)(i + 1));
+            return;
+        }
+        i = (uint32_t)-1; // lost a race: rescan with the fresh bitmap
+    }
+    t_stats_shard = STATS_OVERFLOW;
+}
+
+static inline stats_shard_t *stats_write_begin(stats_t *st)
+{
+    if (t_stats_shard < 0)
+        stats_claim();
+    stats_shard_t *sh = &st->shard[t_stats_shard];
+    uint32_t s = atomic_load_explicit(&sh->seq, memory_order_relaxed);
+    if (t_stats_shard != STATS_OVERFLOW)
+    {
+        atomic_store_explicit(&sh->seq, s + 1, memory_order_relaxed); // sole writer: no RMW
+        atomic_thread_fence(memory_order_release);
+        return sh;
+    }
+    while ((s & 1u) || !atomic_compare_exchange_weak_explicit(&sh->seq, &s, s + 1, memory_order_acquire,
+                                                               memory_order_relaxed))
+    {
+        if (s & 1u)
+        {
+            sched_yield(); // holder may be preempted on an oversubscribed core
+            s = atomic_load_explicit(&sh->seq, memory_order_relaxed);
+        }
+    }
+    atomic_thread_fence(memory_order_release); // odd seq visible before any field store
+    return sh;
+}
+
+static inline void stats_write_end(stats_shard_t *sh)
+{
+    atomic_store_explicit(&sh->seq, atomic_load_explicit(&sh->seq, memory_order_relaxed) + 1,
+                          memory_order_release);
+}
+
+// improved: the caller's own best-so-far decision (g_best_total_ms), kept as-is
+void stats_round(stats_t *st, uint32_t total_ms, bool improved)
+{
+    stats_shard_t *sh = stats_write_begin(st);
+    STATS_ADD(sh->rounds, 1);
+    STATS_ADD(sh->bests, improved);
+    if (total_ms < STATS_LD(sh->best_ms))
+        STATS_ST(sh->best_ms, total_ms);
+    STATS_ADD(sh->sum, total_ms);
+    STATS_ADD(sh->sumsq, (uint64_t)total_ms * total_ms);
+    uint32_t bin = total_ms / STATS_HIST_BIN_MS;
+    STATS_ADD(sh->hist[bin < STATS_HIST_BINS ? bin : STATS_HIST_BINS - 1], 1);
+    stats_write_end(sh);
+}
+
+// Visual-line pulses rejected by the glitch filter
+void stats_glitches(stats_t *st, uint32_t n)
+{
+    stats_shard_t *sh = stats_write_begin(st);
+    STATS_ADD(sh->glitches, n);
+    stats_write_end(sh);
+}
+
+void stats_abort(stats_t *st, abort_cause_t cause)
+{
+    stats_shard_t *sh = stats_write_begin(st);
+    STATS_ADD(sh->aborts[(uint32_t)cause % ABORT_CAUSES], 1);
+    stats_write_end(sh);
+}
+
+// Consistent copy of one shard; retries while its writer is mid-update
+static void stats_snapshot(stats_shard_t *sh, stats_counts_t *out)
+{
+    for (;;)
+    {
+        uint32_t s0 = atomic_load_explicit(&sh->seq, memory_order_acquire);
+        if (s0 & 1u)
+        {
+            sched_yield();
+            continue;
+        }
+        out->rounds = STATS_LD(sh->rounds);
+        out->bests = STATS_LD(sh->bests);
+        out->glitches = STATS_LD(sh->glitches);
+        for (uint32_t c = 0; c < ABORT_CAUSES; ++c)
+            out->aborts[c] = STATS_LD(sh->aborts[c]);
+        out->best_ms = STATS_LD(sh->best_ms);
+        out->sum = STATS_LD(sh->sum);
+        out->sumsq = STATS_LD(sh->sumsq);
+        for (uint32_t b = 0; b < STATS_HIST_BINS; ++b)
+            out->hist[b] = STATS_LD(sh->hist[b]);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&sh->seq, memory_order_relaxed) == s0)
+            return;
+    }
+}
+
+// Fold all shards; sums are exact, so the merge is plain addition
+void stats_read(stats_t *st, stats_view_t *v)
+{
+    static __thread stats_counts_t snap;
+    uint64_t sum = 0, sumsq = 0;
+    memset(v, 0, sizeof(*v));
+    v->best_ms = 0xFFFFFFFF;
+    for (uint32_t i = 0; i < STATS_SHARDS; ++i)
+    {
+        stats_snapshot(&st->shard[i], &snap);
+        v->rounds += snap.rounds;
+        v->bests += snap.bests;
+        v->glitches += snap.glitches;
+        for (uint32_t c = 0; c < ABORT_CAUSES; ++c)
+            v->aborts[c] += snap.aborts[c];
+        if (snap.best_ms < v->best_ms)
+            v->best_ms = snap.best_ms;
+        for (uint32_t b = 0; b < STATS_HIST_BINS; ++b)
+            v->hist[b] += snap.hist[b];
+        sum += snap.sum;
+        sumsq += snap.sumsq;
+    }
+    double n = (double)v->rounds;
+    v->mean = n > 0.0 ? (double)sum / n : 0.0;
+    v->var = n > 1.0 ? ((double)sumsq - (double)sum * v->mean) / (n - 1.0) : 0.0;
+}
+
+/* =========================
+   Round result pipeline (fan-out by handle)
+   ========================= */
+
+// Downstream consumers; each receives its own reference and must release it
+typedef void (*round_stage_fn)(rec_handle_t h);
+
+static const round_stage_fn round_stages[] = {
+    pi3_uart_send_result,
+    history_stage,
+    pcache_stage,
+    leaderboard_stage,
+    journal_stage,
+};
+
+// Active stage list for this thread's round engine (sim workers install their own)
+static __thread const round_stage_fn *t_stages = round_stages;
+static __thread size_t t_nstages = sizeof(round_stages) / sizeof(round_stages[0]);
+
+// Hand a filled record to every stage, then drop the producer's reference
+void round_publish(rec_handle_t h)
+{
+    for (size_t i = 0; i < t_nstages; ++i)
+    {
+        rec_retain(h);
+        t_stages[i](h);
+    }
+    rec_release(h);
+}
+
+// Publish an aborted round (cause + whatever was measured before the abort)
+void round_publish_abort(abort_cause_t cause)
+{
+    rec_handle_t h = rec_alloc();
+    if (h == REC_NONE)
+        return;
+    round_rec_t *r = rec_get(h);
+    r->seq = ++g_round_seq;
+    r->round_ix = g_round_ix;
+    r->player = g_player_id;
+    r->wait_ms = g_random_wait_ms;
+    r->vis_ms = (cause == ABORT_TACT_TIMEOUT) ? g_visual_ms : 0;
+    r->state = (uint8_t)ST_ABORT_RETRY;
+    r->cause = (uint8_t)cause;
+    round_publish(h);
+}
+
+/* =========================
+   State-machine helpers (composition)
+   ========================= */
+
+void state_to_idle(void)
+{
+    g_state = ST_IDLE;
+    LOG("[SYS] → IDLE\n");
+}
+void state_to_abort(abort_cause_t cause)
+{
+    stats_abort(&g_stats, cause);
+    round_publish_abort(cause);
+    g_state = ST_ABORT_RETRY;
+    g_round_elapsed_ms = g_time;
+    g_time = 0; // reset mock time
+    LOG("[SYS] → ABORT/RETRY\n");
+}
+void state_to_feedback(void)
+{
+    g_state = ST_FEEDBACK;
+    LOG("[SYS] → FEEDBACK\n");
+}
+
+/* =========================
+   HAL (static dispatch; build with -DREFLEX_HAL=mock|replay|sim|term)
+   ========================= */
+#ifndef REFLEX_HAL
+#define REFLEX_HAL mock
+#endif
+#define HAL_ID_mock 0
+#define HAL_ID_replay 1
+#define HAL_ID_sim 2
+#define HAL_ID_term 3
+#define HAL_CAT_(a, b, c) a##b##c
+#define HAL_CAT(a, b, c) HAL_CAT_(a, b, c)
+#define HAL(op) HAL_CAT(hal_, REFLEX_HAL, _##op) // resolves at compile time; every backend op is static inline
+#define HAL_IS(b) (HAL_CAT(HAL_ID_, REFLEX_HAL, ) == HAL_ID_##b)
+#define HAL_NEVER 0xFFFFFFFFu // edge that never happens
+
+// Backend ops: wait_ms() at ARMED, visual(t) / tactile(t) edge seen by ms t from ARMED, pressure() ADC
+
+// mock: the fixed demo table (and WCET/sim overrides of it)
+static inline uint32_t hal_mock_wait_ms(void)
+{
+    return pi1_compute_random_wait_ms();
+}
+static inline int hal_mock_visual(uint32_t t)
+{
+    return visual_sensor_output(t);
+}
+static inline int hal_mock_tactile(uint32_t t)
+{
+    return tactile_sensor_output(t);
+}
+static inline uint16_t hal_mock_pressure(void)
+{
+    return pi3_read_pressure_adc();
+}
+
+// replay: rounds recorded as packed rows (./reflex sim traces), one per g_round_ix
+static const packed_round_t *g_replay_rows;
+static size_t g_replay_n;
+static __thread uint32_t t_edge_vis = HAL_NEVER, t_edge_tact = HAL_NEVER;
+
+static inline uint32_t hal_replay_wait_ms(void)
+{
+    packed_round_t p = g_replay_rows[(g_round_ix - 1) % g_replay_n];
+    uint32_t wait = PR_FIELD(p, WAIT), cause = PR_FIELD(p, CAUSE);
+    // engine measures visual from ms wait - 1 and tactile from the visual edge
+    t_edge_vis = cause == ABORT_FALSE_START ? 0 : cause == ABORT_VIS_TIMEOUT ? HAL_NEVER : wait - 1 + PR_FIELD(p, VIS);
+    t_edge_tact = cause == ABORT_NONE ? t_edge_vis + PR_FIELD(p, TACT) : HAL_NEVER;
+    return wait;
+}
+static inline int hal_replay_visual(uint32_t t)
+{
+    return t >= t_edge_vis;
+}
+static inline int hal_replay_tactile(uint32_t t)
+{
+    return t >= t_edge_tact;
+}
+static inline uint16_t hal_replay_pressure(void)
+{
+    return 1023;
+}
+
+// sim: simulated hardware; reaction times drawn per round, occasional early/absent hand
+static inline uint32_t hal_sim_wait_ms(void)
+{
+    uint32_t wait = pi1_compute_random_wait_ms(), u = mock_rand() % 100;
+    t_edge_vis = u < 5 ? wait / 2 : u < 8 ? HAL_NEVER : wait + 180 + mock_rand() % 340;
+    t_edge_tact = u < 10 ? HAL_NEVER : t_edge_vis + 120 + mock_rand() % 280;
+    return wait;
+}
+static inline int hal_sim_visual(uint32_t t)
+{
+    return t >= t_edge_vis || mock_rand() % 1000 == 0; // ~1 ms noise spike per second
+}
+static inline int hal_sim_tactile(uint32_t t)
+{
+    return t >= t_edge_tact;
+}
+static inline uint16_t hal_sim_pressure(void)
+{
+    return (uint16_t)(600 + mock_rand() % 400);
+}
+
+// term: real time; Enter on stdin is the hand (first) and the press (second)
+static __thread double t_term_t0;
+
+static inline int hal_term_key_at(uint32_t t)
+{
+    double lag = t_term_t0 + t * 1e-3 - wall_now_s();
+    if (lag > 0)
+        sleep_us((uint32_t)(lag * 1e6));
+#ifdef _WIN32
+    if (!_kbhit())
+        return 0;
+    while (_kbhit())
+        (void)_getch(); // consume the key (and anything typed with it)
+    return 1;
+#else
+    struct pollfd pfd = {0, POLLIN, 0};
+    char buf[64];
+    return poll(&pfd, 1, 0) > 0 && read(0, buf, sizeof(buf)) > 0;
+#endif
+}
+static inline uint32_t hal_term_wait_ms(void)
+{
+    printf("[TERM] Wait for GREEN, then Enter (hand) and Enter again (press)\n");
+    t_term_t0 = wall_now_s();
+    return pi1_compute_random_wait_ms();
+}
+static inline int hal_term_visual(uint32_t t)
+{
+    return hal_term_key_at(t);
+}
+static inline int hal_term_tactile(uint32_t t)
+{
+    return hal_term_key_at(t);
+}
+static inline uint16_t hal_term_pressure(void)
+{
+    return 1023;
+}
+
+/* =========================
+   Round steps (one per state handler)
+   ========================= */
+
+// Visual-line glitch filter: K-of-N vote plus minimum pulse width; a clean edge is confirmed exactly
+// VIS_FILTER_LATENCY_MS samples late, so that delay is subtracted from the measurement
+#define VIS_FILTER_LATENCY_MS ((VIS_FILTER_K > VIS_FILTER_MIN_WIDTH_MS ? VIS_FILTER_K : VIS_FILTER_MIN_WIDTH_MS) - 1)
+_Static_assert(VIS_FILTER_N >= 1 && VIS_FILTER_N <= 32 && VIS_FILTER_K >= 1 && VIS_FILTER_K <= VIS_FILTER_N,
+               "glitch filter needs 1 <= K <= N <= 32");
+
+typedef struct
+{
+    uint32_t window;   // last N samples, bit 0 = newest
+    uint32_t run;      // consecutive high samples
+    uint32_t last_t;   // last sampled ms (prewait and visual scans share one sample stream)
+    uint32_t glitches; // pulses that ended before being confirmed
+} vis_filter_t;
+
+static __thread vis_filter_t g_vis_filter;
+
+static inline void vis_filter_reset(vis_filter_t *f)
+{
+    f->window = 0;
+    f->run = 0;
+    f->last_t = 0xFFFFFFFFu;
+    f->glitches = 0;
+}
+
+// Feed the raw line at ms t (a repeated t is ignored); true once the edge is confirmed
+static inline int vis_filter_push(vis_filter_t *f, uint32_t t, int raw)
+{
+    if (t != f->last_t)
+    {
+        f->last_t = t;
+        f->window = ((f->window << 1) | (raw != 0)) & (uint32_t)(((uint64_t)1 << VIS_FILTER_N) - 1);
+        if (raw)
+            f->run++;
+        else if (f->run)
+        {
+            f->glitches++;
+            f->run = 0;
+        }
+    }
+    return f->run >= VIS_FILTER_MIN_WIDTH_MS && __builtin_popcount(f->window) >= VIS_FILTER_K;
+}
+
+
+// ARMED: scan for early hand during the foreperiod; false → ABORT/RETRY
+bool round_prewait_scan(void)
+{
+    vis_filter_reset(&g_vis_filter);
+    // Early hand? (false trigger) — PI2
+    for (uint32_t t = g_time; t < g_random_wait_ms; t += 1)
+    {
+        PROF_BEGIN(PROF_SENSOR_READ);
+        int hit = vis_filter_push(&g_vis_filter, t, HAL(visual)(t));
+        PROF_END(PROF_SENSOR_READ);
+        if (hit)
+        {
+            stats_glitches(&g_stats, g_vis_filter.glitches);
+            state_to_abort(ABORT_FALSE_START);
+            return false;
+        }
+        g_time = t;
+    }
+    return true;
+}
+
+// STIM_ON: VISUAL measure — PI2; false → ABORT/RETRY on visual timeout
+bool round_visual_scan(void)
+{
+    uint32_t visual_start_time = g_time; // Capture start time to avoid issues if g_time changes
+    // the filter confirms an edge VIS_FILTER_LATENCY_MS late, so the window stretches by as much
+    for (uint32_t t = visual_start_time; t < visual_start_time + VISUAL_WINDOW_MS + VIS_FILTER_LATENCY_MS; t += 1)
+    {
+        PROF_BEGIN(PROF_SENSOR_READ);
+        int hit = vis_filter_push(&g_vis_filter, t, HAL(visual)(t));
+        PROF_END(PROF_SENSOR_READ);
+        if (hit)
+        {
+            uint32_t edge = t - VIS_FILTER_LATENCY_MS; // filter delay removed from the measurement
+            if (edge < visual_start_time + 1)
+            {
+                // crossed during the foreperiod, confirmed only after STIM_ON: still a false start
+                stats_glitches(&g_stats, g_vis_filter.glitches);
+                state_to_abort(ABORT_FALSE_START);
+                return false;
+            }
+            g_visual_ms = edge - visual_start_time;
+            g_state = ST_VIS_DONE;
+            g_time = edge; // tactile is timed from the edge
+            break;
+        }
+        g_time = t; // Update g_time as we progress through the loop
+    }
+    stats_glitches(&g_stats, g_vis_filter.glitches);
+    if (g_state != ST_VIS_DONE)
+    {
+        state_to_abort(ABORT_VIS_TIMEOUT); // treat visual timeout as abort/retry
+        return false;
+    }
+    pi1_7seg_show_ms("VIS", g_visual_ms);
+    return true;
+}
+
+// VIS_DONE: TACTILE measure — PI3 (ADC read per ms); false → ABORT/RETRY
+bool round_tactile_scan(void)
+{
+    uint32_t tactile_start_time = g_time; // Capture start time
+    for (uint32_t t = tactile_start_time; t < tactile_start_time + TACTILE_WINDOW_MS; t += 1)
+    {
+        PROF_BEGIN(PROF_SENSOR_READ);
+        uint16_t adc = HAL(pressure)();
+        PROF_END(PROF_SENSOR_READ);
+        // if pressure threshold crossed and within window
+        PROF_BEGIN(PROF_THRESHOLD);
+        bool pressed = adc >= g_pressure_threshold && HAL(tactile)(t);
+        PROF_END(PROF_THRESHOLD);
+        if (pressed)
+        {
+            g_tactile_ms = t - tactile_start_time;
+            g_state = ST_TACT_DONE;
+            g_time = t; // Update g_time
+            pi1_7seg_show_ms("TAC", g_tactile_ms);
+            break;
+        }
+        g_time = t; // Update g_time
+    }
+    if (g_state != ST_TACT_DONE)
+    {
+        LOG("[SYS] No tactile within window → N/A\n");
+        state_to_abort(ABORT_TACT_TIMEOUT); // treat tactile timeout as abort/retry
+        return false;
+    }
+    return true;
+}
+
+// REPORT: total, best tracking, UART result
+void round_report(void)
+{
+    atomic_fetch_add_explicit(&g_fg_busy, 1, memory_order_relaxed);
+    g_state = ST_REPORT;
+    g_round_elapsed_ms = g_time;
+    uint32_t total = g_visual_ms + (g_tactile_ms);
+    if (total < g_best_total_ms){
+        g_best_total_ms = total;
+        g_score_improved = true;
+    }
+    stats_round(&g_stats, total, g_score_improved);
+       
+    if (g_active_profile)
+    {
+        g_active_profile->rounds++;
+        if (total < g_active_profile->best_ms)
+            g_active_profile->best_ms = total;
+    }
+
+    pi1_7seg_show_ms("TOT", total);
+
+    rec_handle_t h = rec_alloc();
+    if (h == REC_NONE)
+    {
+        LOG("[SYS] Round record pool exhausted → result dropped\n");
+        atomic_fetch_sub_explicit(&g_fg_busy, 1, memory_order_relaxed);
+        return;
+    }
+    round_rec_t *r = rec_get(h);
+    r->seq = ++g_round_seq;
+    r->round_ix = g_round_ix;
+    r->player = g_player_id;
+    r->wait_ms = g_random_wait_ms;
+    r->vis_ms = g_visual_ms;
+    r->tact_ms = g_tactile_ms;
+    r->total_ms = total;
+    r->best_ms = g_best_total_ms;
+    r->state = (uint8_t)g_state;
+    r->flags = g_score_improved ? REC_F_BEST_IMPROVED : 0;
+    round_publish(h);
+    atomic_fetch_sub_explicit(&g_fg_busy, 1, memory_order_relaxed);
+}
+
+/* =========================
+   One game round (blocking mock)
+   ========================= */
+void run_one_round(void)
+{
+    // Reset score improvement flag at start of each round
+    g_score_improved = false;
+    g_timer_base_ms += g_round_elapsed_ms; // hardware timer keeps running across rounds
+    g_round_elapsed_ms = 0;
+    g_time = 0;
+
+    // IDLE
+    state_to_idle();
+    player_store_prefetch(g_player_id);
+    lb_prefetch(g_player_id);
+    if (!pi1_button_pressed())
+        return;
+
+    // ARMED
+    g_state = ST_ARMED;
+    g_random_wait_ms = HAL(wait_ms)();
+    PROF_BEGIN(PROF_DISPATCH);
+    bool ok = round_prewait_scan();
+    PROF_END(PROF_DISPATCH);
+    if (!ok)
+        return;
+
+    // STIM_ON
+    g_state = ST_STIM_ON;
+    pi1_stim_on_led_and_vibe();
+    {
+        PROF_BEGIN(PROF_DISPATCH);
+        ok = round_visual_scan();
+        PROF_END(PROF_DISPATCH);
+    }
+    if (!ok)
+        return;
+
+    {
+        PROF_BEGIN(PROF_DISPATCH);
+        ok = round_tactile_scan();
+        PROF_END(PROF_DISPATCH);
+    }
+    if (!ok)
+        return;
+
+    // REPORT
+    {
+        PROF_BEGIN(PROF_DISPATCH);
+        round_report();
+        PROF_END(PROF_DISPATCH);
+    }
+
+    // FEEDBACK if best improved — PI1 (LED) + optional buzzer later
+    if (g_score_improved)
+    {
+        state_to_feedback();
+        pi1_feedback_best();
+    }
+    return;
+}
+
+/* =========================
+   Duel mode (two sensor sets, shared STIM_ON)
+   ========================= */
+#define DUEL_PLAYERS 2
+#define DUEL_ROUNDS 4
+
+// Per-player mock input; times are input-capture latches in µs relative to STIM_ON
+typedef struct
+{
+    int32_t vis_us;    // hand crosses visual line (< 0 → during foreperiod = false start)
+    uint32_t tact_us;  // press after visual capture
+    uint16_t pressure; // ADC value on this player's channel
+} duel_input_t;
+
+static const duel_input_t duel_data[DUEL_ROUNDS][DUEL_PLAYERS] = {
+    {{320400, 180250, 600}, {320100, 180300, 650}},   // same ms total, decided sub-ms
+    {{-400000, 0, 600}, {350000, 170000, 700}},       // P1 false start → P2 by forfeit
+    {{300000, 200000, 600}, {1300000, 0, 650}},       // P2 visual timeout
+    {{280500, 150000, 200}, {410000, 220000, 640}}    // P1 pressure below threshold
+};
+
+typedef enum
+{
+    LANE_WAIT_VIS = 0,
+    LANE_WAIT_TACT,
+    LANE_DONE,
+    LANE_OUT
+} lane_phase_t;
+
+typedef struct
+{
+    lane_phase_t phase;
+    uint32_t vis_us;
+    uint32_t tact_us;
+    abort_cause_t cause;
+} duel_lane_t;
+
+static uint32_t g_duel_best_us[DUEL_PLAYERS] = {0xFFFFFFFF, 0xFFFFFFFF};
+static uint32_t g_duel_player[DUEL_PLAYERS]; // session's player ids; 0 = guest lane (no id on the record)
+
+// Duel rounds skip the per-player stages (cache, leaderboard/percentile, journal index): a duel lane is not a
+// solo round, and guest lanes have no player to file it under
+static const round_stage_fn duel_stages[] = {pi3_uart_send_result, history_stage};
+
+// Mock: pressure ADC on player p's channel
+uint16_t duel_read_pressure_adc(int p)
+{
+    return duel_data[g_round_ix - 1][p].pressure;
+}
+
+// Advance one lane by one 1 ms tick (t_ms since STIM_ON); true when it settled this tick
+static bool duel_lane_tick(duel_lane_t *ln, int p, uint32_t t_ms)
+{
+    const duel_input_t *in = &duel_data[g_round_ix - 1][p];
+    uint32_t tick_end_us = (t_ms + 1) * 1000u;
+
+    if (ln->phase == LANE_WAIT_VIS)
+    {
+        if (in->vis_us >= 0 && (uint32_t)in->vis_us < tick_end_us)
+        {
+            ln->vis_us = (uint32_t)in->vis_us;
+            ln->phase = LANE_WAIT_TACT;
+        }
+        else if (t_ms + 1 >= VISUAL_WINDOW_MS)
+        {
+            ln->phase = LANE_OUT;
+            ln->cause = ABORT_VIS_TIMEOUT;
+            return true;
+        }
+        return false;
+    }
+    if (ln->phase == LANE_WAIT_TACT)
+    {
+        uint32_t press_at_us = ln->vis_us + in->tact_us;
+        if (duel_read_pressure_adc(p) >= PRESSURE_THRESHOLD && in->tact_us > 0 && press_at_us < tick_end_us)
+        {
+            ln->tact_us = in->tact_us;
+            ln->phase = LANE_DONE;
+            return true;
+        }
+        if (tick_end_us >= ln->vis_us + TACTILE_WINDOW_MS * 1000u)
+        {
+            ln->phase = LANE_OUT;
+            ln->cause = ABORT_TACT_TIMEOUT;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void duel_publish(int p, const duel_lane_t *ln, uint8_t flags)
+{
+    rec_handle_t h = rec_alloc();
+    if (h == REC_NONE)
+        return;
+    round_rec_t *r = rec_get(h);
+    r->seq = ++g_round_seq;
+    r->round_ix = g_round_ix;
+    r->player = g_duel_player[p];
+    r->wait_ms = g_random_wait_ms;
+    r->vis_ms = ln->vis_us / 1000u;
+    r->tact_ms = ln->tact_us / 1000u;
+    r->total_ms = (ln->vis_us + ln->tact_us) / 1000u;
+    r->best_ms = g_duel_best_us[p] == 0xFFFFFFFF ? 0xFFFFFFFF : g_duel_best_us[p] / 1000u;
+    r->cause = (uint8_t)ln->cause;
+    r->state = (uint8_t)(ln->phase == LANE_DONE ? ST_REPORT : ST_ABORT_RETRY);
+    r->flags = flags;
+    round_publish(h);
+}
+
+// One duel round: both lanes are advanced in the same 1 ms tick; returns winner (0/1) or -1
+int run_one_duel_round(void)
+{
+    duel_lane_t lane[DUEL_PLAYERS];
+    memset(lane, 0, sizeof(lane));
+
+    state_to_idle();
+    if (!pi1_button_pressed())
+        return -1;
+
+    // ARMED: shared foreperiod; a hand on either line forfeits that player
+    g_state = ST_ARMED;
+    g_random_wait_ms = pi1_compute_random_wait_ms();
+    int settled = 0;
+    for (int p = 0; p < DUEL_PLAYERS; ++p)
+    {
+        if (duel_data[g_round_ix - 1][p].vis_us < 0)
+        {
+            LOG("[SYS] P%d false start → forfeit\n", p + 1);
+            lane[p].phase = LANE_OUT;
+            lane[p].cause = ABORT_FALSE_START;
+            settled++;
+        }
+    }
+
+    // STIM_ON shared by both players, then one pass per ms over both lanes
+    g_state = ST_STIM_ON;
+    pi1_stim_on_led_and_vibe();
+    for (uint32_t t = 0; settled < DUEL_PLAYERS && t < VISUAL_WINDOW_MS + TACTILE_WINDOW_MS; ++t)
+    {
+        for (int p = 0; p < DUEL_PLAYERS; ++p)
+        {
+            if (lane[p].phase >= LANE_DONE)
+                continue;
+            if (duel_lane_tick(&lane[p], p, t))
+            {
+                settled++;
+                if (lane[p].phase == LANE_DONE)
+                    LOG("[PI1] 7SEG: P%d TOT = %u.%03u ms\n", p + 1,
+                        (lane[p].vis_us + lane[p].tact_us) / 1000u, (lane[p].vis_us + lane[p].tact_us) % 1000u);
+                else
+                    LOG("[SYS] P%d timeout → N/A\n", p + 1);
+            }
+        }
+        g_time = t;
+    }
+
+    // REPORT: lowest total wins; µs capture latches break ms-level ties
+    g_state = ST_REPORT;
+    int winner = -1;
+    uint32_t best_total = 0xFFFFFFFF;
+    for (int p = 0; p < DUEL_PLAYERS; ++p)
+    {
+        if (lane[p].phase != LANE_DONE)
+            continue;
+        uint32_t total = lane[p].vis_us + lane[p].tact_us;
+        if (total < best_total)
+        {
+            best_total = total;
+            winner = p;
+        }
+        else if (total == best_total)
+        {
+            winner = -1; // exact µs tie
+        }
+        if (total < g_duel_best_us[p])
+            g_duel_best_us[p] = total;
+    }
+    const round_stage_fn *stages = t_stages;
+    size_t nstages = t_nstages;
+    t_stages = duel_stages;
+    t_nstages = sizeof(duel_stages) / sizeof(duel_stages[0]);
+    for (int p = 0; p < DUEL_PLAYERS; ++p)
+        duel_publish(p, &lane[p], p == winner ? REC_F_DUEL_WIN : 0);
+    t_stages = stages;
+    t_nstages = nstages;
+
+    if (winner >= 0)
+    {
+        char msg[16];
+        snprintf(msg, sizeof(msg), "P%d WIN", winner + 1);
+        pi1_7seg_show_msg(msg);
+    }
+    else
+    {
+        pi1_7seg_show_msg(best_total == 0xFFFFFFFF ? "NO WIN" : "TIE");
+    }
+    return winner;
+}
+
+// p1, p2: the two players' ids (0 = guest)
+int duel_run(uint32_t p1, uint32_t p2)
+{
+    g_duel_player[0] = p1;
+    g_duel_player[1] = p2;
+    printf("=== Reflex Game Duel Mode (Mock) ===\n");
+    srand(time(NULL));
+    for (g_round_ix = 1; g_round_ix <= DUEL_ROUNDS; ++g_round_ix)
+    {
+        printf("\n----- Duel %u -----\n", g_round_ix);
+        run_one_duel_round();
+    }
+    for (int p = 0; p < DUEL_PLAYERS; ++p)
+    {
+        if (g_duel_best_us[p] == 0xFFFFFFFF)
+            printf("P%d best = N/A\n", p + 1);
+        else
+            printf("P%d best = %u.%03u ms\n", p + 1, g_duel_best_us[p] / 1000u, g_duel_best_us[p] % 1000u);
+    }
+    return 0;
+}
+
+/* =========================
+   Station mode (player queue, zero-gap round scheduling)
+   ========================= */
+#define STATION_PLAYERS 24    // players served per simulated shift
+#define STATION_QUEUE_LEN 8   // waiting players held in the queue
+#define SESSION_ROUNDS 6      // rounds per player session
+#define PROFILE_LOAD_MS 900   // mock: fetch profile from store
+#define CALIBRATION_MS 600    // mock: per-player pressure calibration
+#define HANDOVER_MS 2500      // next player steps up to the station
+#define REPORT_HOLD_MS 1500   // sequential mode: TOT shown before next IDLE
+
+typedef struct
+{
+    uint32_t player_id;
+    player_profile_t *profile; // store record, updated in place by REPORT
+    uint16_t threshold;        // calibrated PI3 threshold
+    bool preloaded;
+} player_session_t;
+
+typedef struct
+{
+    uint64_t sim_ms;  // station wall time
+    uint64_t idle_ms; // station not inside a round
+    uint32_t players;
+    uint32_t rounds;
+} station_stats_t;
+
+static player_session_t g_session_buf[STATION_QUEUE_LEN];
+static pool_t g_session_pool;
+
+// Mock: profile fetch + calibration (cost is accounted by the caller in sim time)
+static void station_load_session(player_session_t *s)
+{
+    s->profile = player_store_get(s->player_id);
+    s->threshold = (uint16_t)(PRESSURE_THRESHOLD - (s->player_id % 3) * 10);
+    s->preloaded = true;
+}
+
+// Serve STATION_PLAYERS through the queue; pipelined = preload next + zero-gap rounds
+static void station_simulate(bool pipelined, station_stats_t *st)
+{
+    player_session_t *queue[STATION_QUEUE_LEN];
+    uint32_t q_head = 0, q_len = 0, next_id = 1;
+    uint32_t last_round_ms = 0;
+
+    memset(st, 0, sizeof(*st));
+    memset(g_profiles, 0, sizeof(g_profiles));
+    pool_init(&g_session_pool, g_session_buf, sizeof(player_session_t), STATION_QUEUE_LEN);
+
+    while (st->players < STATION_PLAYERS)
+    {
+        // busy venue: keep the queue topped up
+        while (q_len < STATION_QUEUE_LEN && next_id <= STATION_PLAYERS)
+        {
+            player_session_t *s = (player_session_t *)pool_alloc(&g_session_pool);
+            s->player_id = next_id++;
+            s->preloaded = false;
+            queue[(q_head + q_len++) % STATION_QUEUE_LEN] = s;
+        }
+        player_session_t *cur = queue[q_head];
+        q_head = (q_head + 1) % STATION_QUEUE_LEN;
+        q_len--;
+
+        // player gap: handover, plus whatever profile/calibration work did not overlap
+        uint32_t load_ms = PROFILE_LOAD_MS + CALIBRATION_MS;
+        uint32_t gap = HANDOVER_MS;
+        if (!cur->preloaded)
+        {
+            station_load_session(cur);
+            gap += load_ms;
+        }
+        else if (load_ms > last_round_ms && load_ms - last_round_ms > gap)
+        {
+            gap = load_ms - last_round_ms;
+        }
+        st->idle_ms += gap;
+        st->sim_ms += gap;
+
+        g_player_id = cur->player_id;
+        g_active_profile = cur->profile;
+        g_best_total_ms = cur->profile->best_ms;
+        g_pressure_threshold = cur->threshold;
+        for (uint32_t r = 1; r <= SESSION_ROUNDS; ++r)
+        {
+            // last round: preload the next queued player while this one finishes
+            if (pipelined && r == SESSION_ROUNDS && q_len > 0)
+                station_load_session(queue[q_head]);
+
+            g_round_ix = r;
+            run_one_round(); // REPORT handoff returns here; next foreperiod starts at once
+            last_round_ms = g_round_elapsed_ms;
+            st->sim_ms += g_round_elapsed_ms;
+            st->rounds++;
+            if (!pipelined)
+            {
+                st->idle_ms += REPORT_HOLD_MS;
+                st->sim_ms += REPORT_HOLD_MS;
+            }
+        }
+
+        pool_free(&g_session_pool, cur);
+        st->players++;
+    }
+    g_player_id = 0;
+    g_active_profile = NULL;
+    g_best_total_ms = 0xFFFFFFFF;
+    g_pressure_threshold = PRESSURE_THRESHOLD;
+}
+
+static void station_print(const char *label, const station_stats_t *st)
+{
+    double hours = (double)st->sim_ms / 3600000.0;
+    printf("%-10s players/h %7.1f  idle gap/round %7.1f ms  idle %5.1f%%  (%u players, %u rounds, %.1f min)\n",
+           label, hours > 0 ? st->players / hours : 0.0,
+           st->rounds ? (double)st->idle_ms / st->rounds : 0.0,
+           st->sim_ms ? 100.0 * (double)st->idle_ms / (double)st->sim_ms : 0.0,
+           st->players, st->rounds, (double)st->sim_ms / 60000.0);
+}
+
+// Optional journal prefix persists every round (see ./reflex history), compacted in the background
+int station_run(const char *journal_prefix)
+{
+    station_stats_t seq, pipe;
+    compactor_t cp = {&g_journal, false, 0, 0, 0};
+    pthread_t compactor;
+    if (journal_prefix && !journal_open(&g_journal, journal_prefix))
+    {
+        printf("station: cannot open journal '%s'\n", journal_prefix);
+        return 1;
+    }
+    if (journal_prefix)
+        pthread_create(&compactor, NULL, compactor_main, &cp);
+    printf("=== Station throughput (%u players x %u rounds, mock time) ===\n", STATION_PLAYERS, SESSION_ROUNDS);
+    g_quiet = true;
+    srand(443);
+    station_simulate(false, &seq);
+    srand(443);
+    station_simulate(true, &pipe);
+    g_quiet = false;
+    station_print("sequential", &seq);
+    station_print("pipelined", &pipe);
+    stats_view_t v;
+    stats_read(&g_stats, &v);
+    printf("station %u: %llu visual glitches filtered (K=%d of N=%d, min width %d ms, +%d ms latency removed)\n",
+           STATION_ID, (unsigned long long)v.glitches, VIS_FILTER_K, VIS_FILTER_N, VIS_FILTER_MIN_WIDTH_MS,
+           VIS_FILTER_LATENCY_MS);
+    if (journal_prefix)
+    {
+        atomic_store(&cp.stop, true);
+        pthread_join(compactor, NULL);
+        printf("journal: %llu rounds appended to %s.journal, %u segments compacted\n",
+               (unsigned long long)g_journal.appended, journal_prefix, cp.segments);
+    }
+    journal_close(&g_journal);
+    return 0;
+}
+
+/* =========================
+   Soak test (./reflex soak [days] [prefix]; fast-forward station clock)
+   ========================= */
+#define SOAK_DAYS_DEFAULT 60u
+#define SOAK_DAY_MS (24u * 3600u * 1000u)
+#define SOAK_WRAP_WAIT_MS 2000u           // first round: fixed foreperiod ...
+#define SOAK_WRAP_STIM_LEAD_MS 100u       // ... so STIM fires this long before the 32-bit ms timer wraps
+#define SOAK_PLAYERS 100000u              // player ids cycle through the store
+#define SOAK_RSS_SLACK_KIB 4096u          // allowed RSS growth first → last day
+#define SOAK_BACKLOG_SLACK 1u             // allowed compaction backlog growth first → last day (segments)
+#define SOAK_COST_DRIFT 1.5               // allowed per-round cost growth first → last day (daily median)
+#define SOAK_COST_BINS 512                // per-round cycles histogram, 16 bins per octave
+
+static uint64_t g_soak_wrap_errors; // completed rounds whose stimulus LED was dark at REPORT
+
+// Hub side of the UART link: every published round is ingested as the hub would decode it.
+// Runs inside REPORT (before FEEDBACK re-fires the LED), so the stimulus must still be lit, across the timer wrap too.
+static void soak_hub_stage(rec_handle_t h)
+{
+    const round_rec_t *r = rec_get(h);
+    hub_frame_t f = {STATION_ID, r->seq, round_pack(r, r->player)};
+    hub_ingest(&f);
+    if (r->cause == ABORT_NONE && !wave_level(WAVE_LED, timer_now_ms()))
+        g_soak_wrap_errors++;
+    rec_release(h);
+}
+
+static const round_stage_fn soak_stages[] = {pi3_uart_send_result, history_stage, journal_stage, soak_hub_stage};
+
+static uint32_t rec_pool_in_use(void)
+{
+    uint32_t free_n = 0;
+    for (uint32_t h = atomic_load(&g_rec_free_head) & 0xFFFFu; h != REC_NONE && free_n <= ROUND_REC_POOL_SIZE;
+         h = g_rec_pool[h].next)
+        free_n++;
+    return ROUND_REC_POOL_SIZE - free_n;
+}
+
+// Resident set from /proc (0 without procfs: the RSS drift check then passes trivially)
+static uint64_t rss_kib(void)
+{
+#ifdef __linux__
+    unsigned long size = 0, resident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f)
+    {
+        if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+            resident = 0;
+        fclose(f);
+    }
+    return (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE) / 1024u;
+#else
+    return 0;
+#endif
+}
+
+static double soak_median_cycles(const uint32_t *hist, uint64_t n)
+{
+    uint64_t cum = 0;
+    for (uint32_t b = 0; b < SOAK_COST_BINS; ++b)
+        if ((cum += hist[b]) * 2 >= n)
+            return exp2((b + 0.5) / 16.0);
+    return 0.0;
+}
+
+// Days of station operation in mock time: drift in memory, queues and per-round cost, and timer wraparound
+int soak_run(uint32_t days, const char *journal_prefix)
+{
+    compactor_t cp = {&g_journal, false, 0, 0, 0};
+    pthread_t compactor;
+    if (journal_prefix && !journal_open(&g_journal, journal_prefix))
+    {
+        printf("soak: cannot open journal '%s'\n", journal_prefix);
+        return 1;
+    }
+    if (journal_prefix)
+        pthread_create(&compactor, NULL, compactor_main, &cp);
+
+    printf("=== Soak (%u days mock time; first round straddles the 2^32 ms timer wrap, next wrap at day ~49.7) ===\n",
+           days);
+    printf("%4s %8s %9s %9s %6s %7s %7s %10s %10s %5s\n", "day", "rounds", "cyc p50", "rss KiB", "recs",
+           "backlog", "hub gap", "journal", "timer ms", "wrapE");
+    g_quiet = true;
+    srand(443);
+    t_stages = soak_stages;
+    t_nstages = sizeof(soak_stages) / sizeof(soak_stages[0]);
+    g_timer_base_ms = 0u - HANDOVER_MS - (SOAK_WRAP_WAIT_MS - 1) - SOAK_WRAP_STIM_LEAD_MS;
+    g_mock_wait_ms = SOAK_WRAP_WAIT_MS;
+    // fixed-size stores are faulted in up front so RSS drift only shows real growth
+    memset(g_history_buf, 0, sizeof(g_history_buf));
+    memset(g_profiles, 0, sizeof(g_profiles));
+
+    static uint32_t cost_hist[SOAK_COST_BINS];
+    uint64_t sim_ms = 0, published = 0, rss_first = 0, rss_last = 0;
+    uint32_t backlog_first = 0, backlog_last = 0;
+    double cost_first = 0.0, cost_last = 0.0;
+    uint32_t player = 0, day = 0;
+    uint64_t day_rounds = 0, wrap_seen = 0;
+    while (day < days)
+    {
+        // next player steps up; the station clock and the timer keep running through the handover
+        player = player % SOAK_PLAYERS + 1;
+        g_player_id = player;
+        g_active_profile = player_store_get(player);
+        g_best_total_ms = g_active_profile->best_ms;
+        g_pressure_threshold = (uint16_t)(PRESSURE_THRESHOLD - (player % 3) * 10);
+        g_timer_base_ms += HANDOVER_MS;
+        sim_ms += HANDOVER_MS;
+        for (uint32_t r = 1; r <= SESSION_ROUNDS; ++r)
+        {
+            g_round_ix = r;
+            uint64_t c0 = cycles_now();
+            run_one_round();
+            g_mock_wait_ms = 0;
+            double lg = log2((double)(cycles_now() - c0) + 1.0) * 16.0;
+            cost_hist[lg < SOAK_COST_BINS - 1 ? (uint32_t)lg : SOAK_COST_BINS - 1]++;
+            day_rounds++;
+            published++;
+            sim_ms += g_round_elapsed_ms + REPORT_HOLD_MS;
+            g_timer_base_ms += REPORT_HOLD_MS;
+        }
+        if (sim_ms >= (uint64_t)(day + 1) * SOAK_DAY_MS)
+        {
+            uint64_t day_wrap = g_soak_wrap_errors - wrap_seen;
+            wrap_seen = g_soak_wrap_errors;
+            bool show = (day + 1) % ((days + 29) / 30) == 0 || day + 1 == days; // ≤ ~30 rows
+            const hub_station_t *hs = &g_hub[STATION_ID];
+            double cost = soak_median_cycles(cost_hist, day_rounds);
+            uint64_t rss = rss_kib();
+            uint32_t backlog = 0; // sealed segments not yet compacted
+            if (journal_prefix)
+                backlog = atomic_load(&g_journal.next_seg) - atomic_load(&g_journal.compacted);
+            if (day == 0)
+                cost_first = cost, rss_first = rss, backlog_first = backlog;
+            cost_last = cost, rss_last = rss, backlog_last = backlog;
+            if (show)
+                printf("%4u %8llu %9.0f %9llu %6u %7u %7llu %10llu %10u %5llu\n", day + 1,
+                       (unsigned long long)day_rounds, cost, (unsigned long long)rss, rec_pool_in_use(), backlog,
+                       (unsigned long long)hs->gap_frames, (unsigned long long)g_journal.appended, timer_now_ms(),
+                       (unsigned long long)day_wrap);
+            memset(cost_hist, 0, sizeof(cost_hist));
+            day_rounds = 0;
+            day++;
+        }
+    }
+    t_stages = round_stages;
+    t_nstages = sizeof(round_stages) / sizeof(round_stages[0]);
+    g_player_id = 0;
+    g_active_profile = NULL;
+    g_best_total_ms = 0xFFFFFFFF;
+    g_pressure_threshold = PRESSURE_THRESHOLD;
+    g_quiet = false;
+    if (journal_prefix)
+    {
+        atomic_store(&cp.stop, true);
+        pthread_join(compactor, NULL);
+    }
+    journal_close(&g_journal);
+
+    const hub_station_t *hs = &g_hub[STATION_ID];
+    bool backlog_grew = backlog_last > backlog_first + SOAK_BACKLOG_SLACK;
+    bool leak = rec_pool_in_use() != 0 || rss_last > rss_first + SOAK_RSS_SLACK_KIB || backlog_grew;
+    bool drift = cost_first > 0 && cost_last > SOAK_COST_DRIFT * cost_first;
+    bool hub_ok = hs->accepted == published && hs->gap_frames == 0 && hs->dups == 0;
+    printf("%.1f days, %llu rounds: records %s, RSS %+lld KiB, backlog %u → %u%s, cost %.2fx, hub %s, "
+           "timer wrap %s\n",
+           sim_ms / (double)SOAK_DAY_MS, (unsigned long long)published, rec_pool_in_use() ? "LEAKED" : "ok",
+           (long long)rss_last - (long long)rss_first, backlog_first, backlog_last, backlog_grew ? " GROWING" : "",
+           cost_first > 0 ? cost_last / cost_first : 0.0,
+           hub_ok ? "exactly-once" : "MISMATCH", g_soak_wrap_errors ? "ERRORS" : "ok");
+    return leak || drift || !hub_ok || g_soak_wrap_errors ? 1 : 0;
+}
+
+/* =========================
+   Batch simulation (./reflex sim; NUMA-pinned Monte Carlo workers)
+   ========================= */
+#define SIM_MAX_NODES 8                     // NUMA nodes probed under /sys/devices/system/node
+#define SIM_MAX_WORKERS 256                 // one pinned worker per allowed CPU
+#define SIM_SESSIONS_DEFAULT 20000u         // player sessions per run (all workers)
+#define SIM_SESSION_ARENA_BYTES (16u * 1024u) // per-session context, reset between sessions
+#ifdef __linux__
+#define SIM_PIN 1 // pin workers and group them by sysfs NUMA node; elsewhere they run unpinned on node 0
+#else
+#define SIM_PIN 0
+#endif
+
+// Per-session context: the mock sensor table the round engine reads for this player
+typedef struct
+{
+    uint32_t player;
+    uint32_t rows[SESSION_ROUNDS][2]; // [visual_time, tactile_time] from ARMED, like round_data
+} sim_session_t;
+
+typedef struct
+{
+    uint32_t node, cpu, sessions, seed;
+    arena_t arena;          // node-local session arena (first touched by the pinned worker)
+    round_rec_t *recs;      // node-local private record pool (no shared free-list head)
+    packed_round_t *trace;  // node-local trace buffer, one packed row per round
+    size_t ntrace, cap;
+    uint64_t rounds, aborts;
+    double sec;
+    bool failed; // worker could not allocate its node-local buffers
+} sim_worker_t;
+
+static __thread sim_worker_t *t_sim_worker;
+
+// Sim pipeline: every round lands in the worker's own trace buffer (no shared stages)
+static void sim_trace_stage(rec_handle_t h)
+{
+    const round_rec_t *r = rec_get(h);
+    sim_worker_t *w = t_sim_worker;
+    if (w->ntrace < w->cap)
+        w->trace[w->ntrace++] = round_pack(r, r->player);
+    w->rounds++;
+    w->aborts += r->cause != ABORT_NONE;
+    rec_release(h);
+}
+
+static const round_stage_fn sim_stages[] = {sim_trace_stage};
+
+// 64-byte aligned worker buffers (size rounded up, as aligned_alloc requires)
+static void *sim_alloc(size_t bytes)
+{
+    bytes = (bytes + 63) & ~(size_t)63;
+#ifdef _WIN32
+    return _aligned_malloc(bytes ? bytes : 64, 64);
+#else
+    return aligned_alloc(64, bytes ? bytes : 64);
+#endif
+}
+
+static void sim_free(void *p)
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+#if SIM_PIN
+// CPUs of one node from sysfs ("0-3,8-11"); false when the node does not exist
+static bool sim_node_cpus(uint32_t node, cpu_set_t *set)
+{
+    char path[64], buf[1024];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return false;
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    CPU_ZERO(set);
+    for (char *p = buf; *p && *p != '\n';)
+    {
+        unsigned long lo = strtoul(p, &p, 10), hi = lo;
+        if (*p == '-')
+            hi = strtoul(p + 1, &p, 10);
+        for (unsigned long c = lo; c <= hi && c < CPU_SETSIZE; ++c)
+            CPU_SET(c, set);
+        if (*p == ',')
+            ++p;
+    }
+    return true;
+}
+
+// One worker per allowed CPU, grouped by node (every allowed CPU on node 0 without sysfs topology)
+static uint32_t sim_workers_init(sim_worker_t *workers, uint32_t *nnodes)
+{
+    cpu_set_t allowed, node_set;
+    uint32_t nw = 0;
+    *nnodes = 0;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return 0;
+    for (uint32_t node = 0; node < SIM_MAX_NODES && sim_node_cpus(node, &node_set); ++node, ++*nnodes)
+        for (uint32_t c = 0; c < CPU_SETSIZE && nw < SIM_MAX_WORKERS; ++c)
+            if (CPU_ISSET(c, &node_set) && CPU_ISSET(c, &allowed))
+                workers[nw++] = (sim_worker_t){.node = node, .cpu = c};
+    if (nw == 0)
+    {
+        *nnodes = 1;
+        for (uint32_t c = 0; c < CPU_SETSIZE && nw < SIM_MAX_WORKERS; ++c)
+            if (CPU_ISSET(c, &allowed))
+                workers[nw++] = (sim_worker_t){.node = 0, .cpu = c};
+    }
+    return nw;
+}
+
+static void sim_pin_self(uint32_t cpu)
+{
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(cpu, &one);
+    pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+}
+#else
+// No affinity API: one unpinned worker per online CPU, all reported as node 0
+static uint32_t sim_workers_init(sim_worker_t *workers, uint32_t *nnodes)
+{
+    long n = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+#elif defined(_WIN32)
+    n = pthread_num_processors_np();
+#endif
+    if (n < 1)
+        n = 1;
+    uint32_t nw = n < SIM_MAX_WORKERS ? (uint32_t)n : SIM_MAX_WORKERS;
+    for (uint32_t i = 0; i < nw; ++i)
+        workers[i] = (sim_worker_t){.node = 0, .cpu = i};
+    *nnodes = 1;
+    return nw;
+}
+
+static void sim_pin_self(uint32_t cpu)
+{
+    (void)cpu;
+}
+#endif
+
+static void *sim_worker_main(void *arg)
+{
+    sim_worker_t *w = (sim_worker_t *)arg;
+    sim_pin_self(w->cpu);
+
+    // Allocate and first-touch after pinning so the pages come from this node
+    void *abuf = sim_alloc(SIM_SESSION_ARENA_BYTES);
+    w->recs = (round_rec_t *)sim_alloc(REC_PRIVATE_MAX * sizeof(round_rec_t));
+    w->trace = (packed_round_t *)sim_alloc(w->cap * sizeof(packed_round_t));
+    if (!abuf || !w->recs || !w->trace)
+    {
+        sim_free(abuf);
+        sim_free(w->recs);
+        w->recs = NULL;
+        w->cap = 0;
+        w->failed = true;
+        return NULL;
+    }
+    memset(abuf, 0, SIM_SESSION_ARENA_BYTES);
+    memset(w->recs, 0, REC_PRIVATE_MAX * sizeof(round_rec_t));
+    memset(w->trace, 0, w->cap * sizeof(packed_round_t));
+    w->arena = (arena_t){(uint8_t *)abuf, SIM_SESSION_ARENA_BYTES, 0, 0};
+    rec_private_attach(w->recs, REC_PRIVATE_MAX);
+
+    t_sim_worker = w;
+    t_stages = sim_stages;
+    t_nstages = sizeof(sim_stages) / sizeof(sim_stages[0]);
+    t_rng = w->seed;
+    double t0 = wall_now_s();
+    for (uint32_t s = 0; s < w->sessions; ++s)
+    {
+        arena_reset(&w->arena);
+        sim_session_t *ss = (sim_session_t *)arena_alloc(&w->arena, sizeof(sim_session_t), 64);
+        ss->player = 1 + mock_rand() % 100000;
+        for (uint32_t r = 0; r < SESSION_ROUNDS; ++r)
+        {
+            // hand arrives 2.0..4.0 s after ARMED (before the random wait → false start, late → timeout)
+            ss->rows[r][0] = 2000 + mock_rand() % 2000;
+            ss->rows[r][1] = ss->rows[r][0] + 120 + mock_rand() % 600;
+        }
+        g_mock_data = (const uint32_t(*)[2])ss->rows;
+        g_mock_rounds = SESSION_ROUNDS;
+        g_player_id = ss->player;
+        g_best_total_ms = 0xFFFFFFFF;
+        for (g_round_ix = 1; g_round_ix <= SESSION_ROUNDS; ++g_round_ix)
+            run_one_round();
+    }
+    w->sec = wall_now_s() - t0;
+    rec_private_attach(NULL, 0);
+    sim_free(w->recs);
+    w->recs = NULL;
+    sim_free(abuf);
+    return NULL;
+}
+
+// Monte Carlo sessions on one pinned worker per CPU; optional trace prefix writes <prefix>.node<N>.trace
+int sim_run(uint32_t sessions, const char *trace_prefix)
+{
+    static sim_worker_t workers[SIM_MAX_WORKERS];
+    pthread_t th[SIM_MAX_WORKERS];
+    uint32_t nnodes = 0;
+    uint32_t nw = sim_workers_init(workers, &nnodes);
+    if (nw == 0 || sessions == 0)
+    {
+        printf("sim: no CPUs or no sessions\n");
+        return 1;
+    }
+
+    printf("=== Batch simulation (%u sessions x %u rounds, %u workers, %u node%s) ===\n", sessions, SESSION_ROUNDS,
+           nw, nnodes, nnodes == 1 ? "" : "s");
+    bool quiet = g_quiet;
+    g_quiet = true;
+    uint64_t exhausted = atomic_load(&g_rec_exhausted);
+    for (uint32_t i = 0; i < nw; ++i)
+    {
+        workers[i].sessions = sessions / nw + (i < sessions % nw);
+        workers[i].seed = 443u + i * 7919u;
+        workers[i].cap = (size_t)workers[i].sessions * SESSION_ROUNDS;
+        pthread_create(&th[i], NULL, sim_worker_main, &workers[i]);
+    }
+    for (uint32_t i = 0; i < nw; ++i)
+        pthread_join(th[i], NULL);
+    g_quiet = quiet;
+
+    printf("%4s %7s %12s %10s %14s\n", "node", "workers", "rounds", "aborted", "rounds/s");
+    uint64_t all_rounds = 0;
+    double all_rate = 0.0;
+    for (uint32_t node = 0; node < nnodes; ++node)
+    {
+        uint32_t k = 0;
+        uint64_t rounds = 0, aborts = 0;
+        double sec = 0.0;
+        FILE *tf = NULL;
+        if (trace_prefix)
+        {
+            char path[512];
+            snprintf(path, sizeof(path), "%s.node%u.trace", trace_prefix, node);
+            tf = fopen(path, "wb");
+        }
+        for (uint32_t i = 0; i < nw; ++i)
+        {
+            sim_worker_t *w = &workers[i];
+            if (w->node != node)
+                continue;
+            k++;
+            rounds += w->rounds;
+            aborts += w->aborts;
+            if (w->sec > sec)
+                sec = w->sec;
+            if (tf && w->ntrace)
+                fwrite(w->trace, sizeof(packed_round_t), w->ntrace, tf);
+            sim_free(w->trace);
+            w->trace = NULL;
+        }
+        if (tf)
+            fclose(tf);
+        if (!k)
+            continue;
+        double rate = sec > 0 ? (double)rounds / sec : 0.0;
+        printf("%4u %7u %12llu %10llu %14.0f\n", node, k, (unsigned long long)rounds, (unsigned long long)aborts,
+               rate);
+        all_rounds += rounds;
+        all_rate += rate;
+    }
+    printf(" all %7u %12llu %10s %14.0f\n", nw, (unsigned long long)all_rounds, "", all_rate);
+    if (trace_prefix)
+        printf("traces: %s.node<N>.trace (8 B packed rounds, one file per node)\n", trace_prefix);
+    // every round must have been published and counted
+    uint64_t lost = atomic_load(&g_rec_exhausted) - exhausted, expect = (uint64_t)sessions * SESSION_ROUNDS;
+    uint32_t failed = 0;
+    for (uint32_t i = 0; i < nw; ++i)
+        failed += workers[i].failed;
+    if (lost || failed || all_rounds != expect)
+    {
+        printf("sim: FAIL (%llu of %llu rounds counted, %llu records unavailable, %u workers without buffers)\n",
+               (unsigned long long)all_rounds, (unsigned long long)expect, (unsigned long long)lost, failed);
+        return 1;
+    }
+    return 0;
+}
+
+/* =========================
+   Trace replay (./reflex replay <trace>; build with -DREFLEX_HAL=replay)
+   ========================= */
+static __thread size_t t_replay_mismatch;
+
+// Replayed round must reproduce the recorded wait/vis/tact/cause exactly
+static void replay_check_stage(rec_handle_t h)
+{
+    const round_rec_t *r = rec_get(h);
+    packed_round_t want = g_replay_rows[(r->round_ix - 1) % g_replay_n], got = round_pack(r, 0);
+    if (PR_FIELD(want, WAIT) != PR_FIELD(got, WAIT) || PR_FIELD(want, CAUSE) != PR_FIELD(got, CAUSE) ||
+        (PR_FIELD(want, CAUSE) != ABORT_FALSE_START && PR_FIELD(want, VIS) != PR_FIELD(got, VIS)) ||
+        (PR_FIELD(want, CAUSE) == ABORT_NONE && PR_FIELD(want, TACT) != PR_FIELD(got, TACT)))
+        t_replay_mismatch++;
+    rec_release(h);
+}
+
+static const round_stage_fn replay_stages[] = {replay_check_stage};
+
+int replay_run(const char *path)
+{
+    if (!HAL_IS(replay))
+    {
+        printf("replay: rebuild with -DREFLEX_HAL=replay\n");
+        return 1;
+    }
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        printf("replay: cannot open '%s'\n", path);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    size_t n = (size_t)ftell(f) / sizeof(packed_round_t);
+    fseek(f, 0, SEEK_SET);
+    packed_round_t *rows = (packed_round_t *)malloc(n ? n * sizeof(packed_round_t) : 1);
+    n = rows ? fread(rows, sizeof(packed_round_t), n, f) : 0;
+    fclose(f);
+    if (n == 0)
+    {
+        printf("replay: '%s' holds no rounds\n", path);
+        free(rows);
+        return 1;
+    }
+    g_replay_rows = rows;
+    g_replay_n = n;
+    t_stages = replay_stages;
+    t_nstages = 1;
+    g_quiet = true;
+    double t0 = wall_now_s();
+    for (g_round_ix = 1; g_round_ix <= n; ++g_round_ix)
+    {
+        g_player_id = PR_FIELD(rows[g_round_ix - 1], PLAYER);
+        run_one_round();
+    }
+    double sec = wall_now_s() - t0;
+    g_quiet = false;
+    printf("replay: %zu rounds in %.3f s (%.0f rounds/s), %zu mismatches\n", n, sec, sec > 0 ? n / sec : 0.0,
+           t_replay_mismatch);
+    free(rows);
+    return t_replay_mismatch ? 1 : 0;
+}
+
+/* =========================
+   History query (./reflex history <prefix> <player> [k])
+   ========================= */
+#define HISTORY_QUERY_MAX 1000
+
+int history_run(const char *prefix, uint32_t player, size_t k)
+{
+    static journal_rec_t rows[HISTORY_QUERY_MAX];
+    if (k > HISTORY_QUERY_MAX)
+        k = HISTORY_QUERY_MAX;
+    if (!journal_open(&g_journal, prefix))
+    {
+        printf("history: cannot open journal '%s'\n", prefix);
+        return 1;
+    }
+    size_t n = journal_query(&g_journal, player, 0, 0xFFFFFFFF, rows, k);
+    printf("player %u: last %zu rounds (newest first)\n", player, n);
+    printf("%8s %10s %6s %6s %6s  %s\n", "seq", "ts", "wait", "vis", "tact", "cause");
+    for (size_t i = 0; i < n; ++i)
+    {
+        packed_round_t p = rows[i].packed;
+        printf("%8u %10u %6u %6u %6u  %s\n", rows[i].seq, rows[i].ts, PR_FIELD(p, WAIT), PR_FIELD(p, VIS),
+               PR_FIELD(p, TACT), abort_cause_names[PR_FIELD(p, CAUSE) & 3]);
+    }
+    journal_close(&g_journal);
+    return 0;
+}
+
+/* =========================
+   WCET harness (per state handler)
+   ========================= */
+
+// Cycle budgets per handler (override with -D at build time)
+#ifndef WCET_BUDGET_PREWAIT_CYC
+#define WCET_BUDGET_PREWAIT_CYC 2000000u
+#endif
+#ifndef WCET_BUDGET_VISUAL_CYC
+#define WCET_BUDGET_VISUAL_CYC 1000000u
+#endif
+#ifndef WCET_BUDGET_TACTILE_CYC
+#define WCET_BUDGET_TACTILE_CYC 1500000u
+#endif
+#ifndef WCET_BUDGET_REPORT_CYC
+#define WCET_BUDGET_REPORT_CYC 250000u
+#endif
+#define WCET_ITERATIONS 200 // repetitions per adversarial scenario
+
+typedef enum
+{
+    H_PREWAIT = 0,
+    H_VISUAL,
+    H_TACTILE,
+    H_REPORT,
+    H_COUNT
+} wcet_handler_t;
+
+static const char *const wcet_names[H_COUNT] = {"PREWAIT", "VISUAL", "TACTILE", "REPORT"};
+static const uint64_t wcet_budget_cyc[H_COUNT] = {
+    WCET_BUDGET_PREWAIT_CYC, WCET_BUDGET_VISUAL_CYC, WCET_BUDGET_TACTILE_CYC, WCET_BUDGET_REPORT_CYC};
+
+// Adversarial scenario: forced foreperiod + sensor crossing times (ms from round start)
+typedef struct
+{
+    const char *name;
+    uint32_t wait_ms;
+    uint32_t data[1][2]; // [visual_time, tactile_time]
+} wcet_scenario_t;
+
+#define NEVER_MS 0xFFFFFFFFu
+
+static const wcet_scenario_t wcet_scenarios[] = {
+    // Max foreperiod, visual at last ms of window, tactile at last ms of window
+    {"max-wait/last-ms", RANDOM_WAIT_MAX_MS,
+     {{RANDOM_WAIT_MAX_MS - 1 + VISUAL_WINDOW_MS - 1,
+       RANDOM_WAIT_MAX_MS - 1 + VISUAL_WINDOW_MS - 1 + TACTILE_WINDOW_MS - 1}}},
+    // Max foreperiod, visual never crosses (full visual window scanned)
+    {"max-wait/vis-timeout", RANDOM_WAIT_MAX_MS, {{NEVER_MS, NEVER_MS}}},
+    // Max foreperiod, visual immediate, tactile never crosses (full ADC window)
+    {"max-wait/tact-timeout", RANDOM_WAIT_MAX_MS, {{RANDOM_WAIT_MAX_MS, NEVER_MS}}},
+    // Min foreperiod, both at last ms
+    {"min-wait/last-ms", RANDOM_WAIT_MIN_MS,
+     {{RANDOM_WAIT_MIN_MS - 1 + VISUAL_WINDOW_MS - 1,
+       RANDOM_WAIT_MIN_MS - 1 + VISUAL_WINDOW_MS - 1 + TACTILE_WINDOW_MS - 1}}},
+};
+
+#define WCET_CONFIRM_RUNS 3 // runs per sample; the fastest of them gives the preemption-filtered figure
+
+static uint64_t wcet_max_cyc[H_COUNT];  // raw observed max over every run (gated against the budget)
+static uint64_t wcet_filt_cyc[H_COUNT]; // max over samples of the fastest of WCET_CONFIRM_RUNS (informational)
+static uint64_t wcet_sample_cyc[H_COUNT]; // current run; 0 = handler not reached
+
+static void wcet_record(wcet_handler_t h, uint64_t c0)
+{
+    wcet_sample_cyc[h] = cycles_now() - c0;
+}
+
+// Drive one scenario through the handlers, timing each step
+static void wcet_run_scenario(const wcet_scenario_t *sc)
+{
+    uint64_t c0;
+
+    memset(wcet_sample_cyc, 0, sizeof(wcet_sample_cyc));
+    g_mock_data = sc->data;
+    g_mock_rounds = 1;
+    g_round_ix = 1;
+    g_best_total_ms = 0xFFFFFFFF; // force the "best improved" REPORT branch
+
+    g_score_improved = false;
+    g_time = 0;
+    g_state = ST_ARMED;
+    g_random_wait_ms = sc->wait_ms;
+
+    c0 = cycles_now();
+    bool ok = round_prewait_scan();
+    wcet_record(H_PREWAIT, c0);
+    if (!ok)
+        return;
+
+    g_state = ST_STIM_ON;
+    c0 = cycles_now();
+    ok = round_visual_scan();
+    wcet_record(H_VISUAL, c0);
+    if (!ok)
+        return;
+
+    c0 = cycles_now();
+    ok = round_tactile_scan();
+    wcet_record(H_TACTILE, c0);
+    if (!ok)
+        return;
+
+    c0 = cycles_now();
+    round_report();
+    wcet_record(H_REPORT, c0);
+}
+
+// Visual-filter boundary: a hand crossing in the foreperiod's last VIS_FILTER_LATENCY_MS is only
+// confirmed after STIM_ON, and must still abort as a false start
+typedef struct
+{
+    uint32_t vis_edge; // ms from ARMED (foreperiod RANDOM_WAIT_MIN_MS)
+    uint8_t cause;     // expected abort_cause_t
+    uint32_t vis_ms;   // expected g_visual_ms (completed rounds)
+} vis_check_t;
+
+static const vis_check_t vis_checks[] = {
+    {RANDOM_WAIT_MIN_MS - 1 - VIS_FILTER_LATENCY_MS, ABORT_FALSE_START, 0}, // confirmed within the foreperiod
+    {RANDOM_WAIT_MIN_MS - VIS_FILTER_LATENCY_MS, ABORT_FALSE_START, 0},     // confirmed by the visual scan
+    {RANDOM_WAIT_MIN_MS - 1, ABORT_FALSE_START, 0},                         // last foreperiod ms
+    {RANDOM_WAIT_MIN_MS, ABORT_NONE, 1},                                    // first ms after STIM_ON
+};
+
+static __thread uint8_t t_check_cause;
+
+static void vis_check_stage(rec_handle_t h)
+{
+    t_check_cause = rec_get(h)->cause;
+    rec_release(h);
+}
+
+static const round_stage_fn vis_check_stages[] = {vis_check_stage};
+
+// Returns the number of boundary cases that scored differently than expected
+static int vis_check_run(void)
+{
+    const round_stage_fn *stages = t_stages;
+    size_t nstages = t_nstages;
+    int bad = 0;
+    t_stages = vis_check_stages;
+    t_nstages = 1;
+    g_mock_wait_ms = RANDOM_WAIT_MIN_MS;
+    g_mock_rounds = 1;
+    for (size_t i = 0; i < sizeof(vis_checks) / sizeof(vis_checks[0]); ++i)
+    {
+        const vis_check_t *c = &vis_checks[i];
+        uint32_t row[1][2] = {{c->vis_edge, c->vis_edge + TACTILE_WINDOW_MS / 2}};
+        g_mock_data = (const uint32_t(*)[2])row;
+        g_round_ix = 1;
+        t_check_cause = 0xFF;
+        run_one_round();
+        if (t_check_cause != c->cause || (c->cause == ABORT_NONE && g_visual_ms != c->vis_ms))
+        {
+            printf("visual edge at %u ms (wait %u): got %s, expected %s\n", c->vis_edge, RANDOM_WAIT_MIN_MS,
+                   t_check_cause <= ABORT_TACT_TIMEOUT ? abort_cause_names[t_check_cause] : "?",
+                   abort_cause_names[c->cause]);
+            bad++;
+        }
+    }
+    g_mock_wait_ms = 0;
+    t_stages = stages;
+    t_nstages = nstages;
+    return bad;
+}
+
+// Returns 0 when every handler stays within budget and the boundary cases score right, 1 otherwise
+// Measure at real-time priority with locked memory where permitted, so the raw max is the handlers' and not
+// the host scheduler's; returns what was obtained, for the report
+static const char *wcet_host_enter(int *policy, struct sched_param *saved)
+{
+    pthread_getschedparam(pthread_self(), policy, saved);
+#if defined(__linux__) && defined(SCHED_FIFO)
+    struct sched_param sp = {0};
+    sp.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+    bool locked = mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+    bool rt = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0;
+    if (rt)
+        return locked ? "SCHED_FIFO, memory locked" : "SCHED_FIFO";
+    return locked ? "memory locked, no RT priority: max includes host preemption"
+                  : "no RT priority: max includes host preemption";
+#else
+    return "no RT priority: max includes host preemption";
+#endif
+}
+
+static void wcet_host_exit(int policy, const struct sched_param *saved)
+{
+    pthread_setschedparam(pthread_self(), policy, saved);
+#ifdef __linux__
+    munlockall();
+#endif
+}
+
+int wcet_run(void)
+{
+    size_t n = sizeof(wcet_scenarios) / sizeof(wcet_scenarios[0]);
+    int fail = 0;
+    int policy;
+    struct sched_param saved;
+    const char *host = wcet_host_enter(&policy, &saved);
+
+    g_quiet = true;
+    // warm-up: fault in the history ring and caches before measuring
+    memset(g_history_buf, 0, sizeof(g_history_buf));
+    for (size_t i = 0; i < n; ++i)
+        wcet_run_scenario(&wcet_scenarios[i]);
+
+    for (int it = 0; it < WCET_ITERATIONS; ++it)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint64_t best[H_COUNT];
+            for (int k = 0; k < WCET_CONFIRM_RUNS; ++k)
+            {
+                wcet_run_scenario(&wcet_scenarios[i]);
+                for (int h = 0; h < H_COUNT; ++h)
+                {
+                    if (wcet_sample_cyc[h] > wcet_max_cyc[h])
+                        wcet_max_cyc[h] = wcet_sample_cyc[h];
+                    if (k == 0 || wcet_sample_cyc[h] < best[h])
+                        best[h] = wcet_sample_cyc[h];
+                }
+            }
+            for (int h = 0; h < H_COUNT; ++h)
+                if (best[h] > wcet_filt_cyc[h])
+                    wcet_filt_cyc[h] = best[h];
+        }
+    }
+    int vis_bad = vis_check_run();
+    wcet_host_exit(policy, &saved);
+    g_quiet = false;
+
+    // restore demo tables
+    g_mock_data = round_data;
+    g_mock_rounds = 6;
+
+    printf("=== WCET report (%d iterations x %u scenarios x %d runs) ===\n", WCET_ITERATIONS, (unsigned)n,
+           WCET_CONFIRM_RUNS);
+    printf("host: %s\n", host);
+    printf("%-10s %14s %14s %14s  %s\n", "handler", "max_cycles", "min-of-runs", "budget", "status");
+    for (int h = 0; h < H_COUNT; ++h)
+    {
+        bool over = wcet_max_cyc[h] > wcet_budget_cyc[h];
+        printf("%-10s %14llu %14llu %14llu  %s\n", wcet_names[h], (unsigned long long)wcet_max_cyc[h],
+               (unsigned long long)wcet_filt_cyc[h], (unsigned long long)wcet_budget_cyc[h], over ? "FAIL" : "ok");
+        fail |= over;
+    }
+    printf("WCET: %s\n", fail ? "BUDGET EXCEEDED" : "all handlers within budget");
+    printf("visual boundary: %s\n", vis_bad ? "FAIL" : "ok");
+    return fail | (vis_bad != 0);
+}
+
+/* =========================
+   Interrupt controller simulation (./reflex irq [seconds])
+   ========================= */
+#define IRQ_ENTRY_NS 150u            // exception entry (stacking + vector fetch)
+#define IRQ_EXIT_NS 100u             // exception return
+#define IRQ_CAPTURE_LIMIT_NS 10000u  // capture ISRs must start within this
+#define IRQ_HIST_BIN_NS 500u         // latency histogram bin
+#define IRQ_HIST_BINS 64u            // + overflow bin
+#define IRQ_MAX_NEST 8u
+#define IRQ_CRIT_PERIOD_NS 100000u   // thread-mode critical section (all IRQs masked) every ~100 µs
+#define IRQ_CRIT_NS 1500u            // ... lasting this long
+#define IRQ_BASEPRI_PERIOD_NS 1000000u // thread-mode BASEPRI section (prio ≥ IRQ_BASEPRI masked) every ~1 ms
+#define IRQ_BASEPRI_NS 20000u
+#define IRQ_BASEPRI 2u
+
+// prio: lower number preempts higher; arrivals every period_ns + uniform [0, jitter_ns)
+typedef struct
+{
+    const char *name;
+    uint8_t prio;
+    bool capture;
+    uint32_t isr_ns;
+    uint32_t period_ns;
+    uint32_t jitter_ns;
+} irq_src_t;
+
+static const irq_src_t irq_srcs[] = {
+    {"vis-capture", 0, true, 1200, 2000000, 2000000},                   // PI2 input-capture edge
+    {"tact-adc", 1, true, 900, 100000, 0},                              // PI3 end of ADC scan frame
+    {"timer-1ms", 2, false, 1500, 1000000, 0},                          // PI1 tick + waveform DMA reload
+    {"uart-tx", 3, false, 3000, 1000000000u / (UART_BAUD / 10), 0},     // PI3 TX empty, line saturated
+    {"display", 3, false, 6000, 1000000, 0},                            // PI1 7-seg multiplex refresh
+};
+#define IRQ_SOURCES (sizeof(irq_srcs) / sizeof(irq_srcs[0]))
+
+typedef struct
+{
+    uint64_t count, overruns;
+    uint64_t hist[IRQ_HIST_BINS + 1];
+    uint64_t max_ns, min_ns, busy_ns;
+    double sum, sum2;
+} irq_stat_t;
+
+static void irq_record(irq_stat_t *st, uint64_t lat)
+{
+    uint64_t bin = lat / IRQ_HIST_BIN_NS;
+    st->hist[bin < IRQ_HIST_BINS ? bin : IRQ_HIST_BINS]++;
+    st->count++;
+    st->sum += (double)lat;
+    st->sum2 += (double)lat * lat;
+    st->max_ns = lat > st->max_ns ? lat : st->max_ns;
+    st->min_ns = lat < st->min_ns ? lat : st->min_ns;
+}
+
+static uint64_t irq_hist_pct(const irq_stat_t *st, double q)
+{
+    uint64_t cum = 0;
+    for (uint32_t b = 0; b <= IRQ_HIST_BINS; ++b)
+        if ((cum += st->hist[b]) >= (uint64_t)(q * (double)st->count))
+            return (uint64_t)(b + 1) * IRQ_HIST_BIN_NS;
+    return st->max_ns;
+}
+
+// Event-driven NVIC model: priorities, nesting/preemption, PRIMASK and BASEPRI windows in thread mode
+int irq_run(uint32_t seconds)
+{
+    static irq_stat_t st[IRQ_SOURCES];
+    uint64_t next_arr[IRQ_SOURCES], arr_at[IRQ_SOURCES];
+    bool pending[IRQ_SOURCES] = {false};
+    uint32_t stack_src[IRQ_MAX_NEST];
+    uint64_t stack_left[IRQ_MAX_NEST];
+    uint32_t depth = 0, x = 443u;
+    uint64_t end = (uint64_t)seconds * 1000000000u, now = 0;
+    uint64_t crit_next = IRQ_CRIT_PERIOD_NS, crit_end = 0, bp_next = IRQ_BASEPRI_PERIOD_NS, bp_end = 0;
+
+    memset(st, 0, sizeof(st));
+    for (uint32_t s = 0; s < IRQ_SOURCES; ++s)
+    {
+        st[s].min_ns = UINT64_MAX;
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        next_arr[s] = irq_srcs[s].period_ns + (irq_srcs[s].jitter_ns ? x % irq_srcs[s].jitter_ns : 0);
+    }
+    while (now < end)
+    {
+        // arrivals (a source already pending loses the edge: overrun)
+        for (uint32_t s = 0; s < IRQ_SOURCES; ++s)
+            while (next_arr[s] <= now)
+            {
+                if (pending[s])
+                    st[s].overruns++;
+                else
+                    pending[s] = true, arr_at[s] = next_arr[s];
+                x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+                next_arr[s] += irq_srcs[s].period_ns + (irq_srcs[s].jitter_ns ? x % irq_srcs[s].jitter_ns : 0);
+            }
+        if (depth && stack_left[depth - 1] == 0)
+            depth--;
+        // thread-mode masking windows start only while no handler is active
+        if (!depth && now >= crit_next && now >= crit_end)
+        {
+            crit_end = now + IRQ_CRIT_NS;
+            x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+            crit_next = now + IRQ_CRIT_PERIOD_NS / 2 + x % IRQ_CRIT_PERIOD_NS;
+        }
+        if (!depth && now >= bp_next && now >= bp_end && now >= crit_end)
+        {
+            bp_end = now + IRQ_BASEPRI_NS;
+            bp_next = now + IRQ_BASEPRI_PERIOD_NS;
+        }
+        bool thread = depth == 0;
+        uint32_t cur_prio = thread ? 256 : irq_srcs[stack_src[depth - 1]].prio;
+        uint32_t mask_prio = thread && now < crit_end ? 0 : thread && now < bp_end ? IRQ_BASEPRI : 256;
+        int pick = -1;
+        for (uint32_t s = 0; s < IRQ_SOURCES; ++s)
+            if (pending[s] && irq_srcs[s].prio < cur_prio && irq_srcs[s].prio < mask_prio &&
+                (pick < 0 || irq_srcs[s].prio < irq_srcs[pick].prio))
+                pick = (int)s;
+        if (pick >= 0 && depth < IRQ_MAX_NEST)
+        {
+            pending[pick] = false;
+            irq_record(&st[pick], now - arr_at[pick] + IRQ_ENTRY_NS);
+            stack_src[depth] = (uint32_t)pick;
+            stack_left[depth++] = IRQ_ENTRY_NS + irq_srcs[pick].isr_ns + IRQ_EXIT_NS;
+            continue;
+        }
+        // advance to the next event: arrival, handler completion, or a masking window edge
+        uint64_t t = end;
+        for (uint32_t s = 0; s < IRQ_SOURCES; ++s)
+            t = next_arr[s] < t ? next_arr[s] : t;
+        if (depth)
+            t = now + stack_left[depth - 1] < t ? now + stack_left[depth - 1] : t;
+        else
+        {
+            uint64_t edges[4] = {crit_next, crit_end, bp_next, bp_end};
+            for (uint32_t i = 0; i < 4; ++i)
+                if (edges[i] > now && edges[i] < t)
+                    t = edges[i];
+        }
+        if (depth)
+        {
+            stack_left[depth - 1] -= t - now;
+            st[stack_src[depth - 1]].busy_ns += t - now;
+        }
+        now = t;
+    }
+
+    static const char shade[] = " .:-=+*#%@";
+    bool ok = true;
+    printf("=== Interrupt simulation (%u s, UART %u baud saturated, display refresh 1 kHz) ===\n", seconds, UART_BAUD);
+    printf("%-12s %4s %9s %7s %7s %7s %7s %6s %8s\n", "source", "prio", "count", "p50 us", "p99 us", "max us",
+           "sd us", "cpu%", "overruns");
+    for (uint32_t s = 0; s < IRQ_SOURCES; ++s)
+    {
+        const irq_stat_t *q = &st[s];
+        double mean = q->count ? q->sum / q->count : 0.0;
+        double sd = q->count ? sqrt(fmax(0.0, q->sum2 / q->count - mean * mean)) : 0.0;
+        printf("%-12s %4u %9llu %7.2f %7.2f %7.2f %7.2f %6.2f %8llu\n", irq_srcs[s].name, irq_srcs[s].prio,
+               (unsigned long long)q->count, irq_hist_pct(q, 0.5) / 1000.0, irq_hist_pct(q, 0.99) / 1000.0,
+               q->max_ns / 1000.0, sd / 1000.0, 100.0 * q->busy_ns / (double)end, (unsigned long long)q->overruns);
+        if (irq_srcs[s].capture && (q->max_ns >= IRQ_CAPTURE_LIMIT_NS || q->overruns))
+            ok = false;
+    }
+    printf("latency histograms (%.1f us/bin, 0..%u us, last = overflow):\n", IRQ_HIST_BIN_NS / 1000.0,
+           IRQ_HIST_BINS * IRQ_HIST_BIN_NS / 1000);
+    for (uint32_t s = 0; s < IRQ_SOURCES; ++s)
+    {
+        char line[IRQ_HIST_BINS + 2];
+        uint64_t peak = 1;
+        for (uint32_t b = 0; b <= IRQ_HIST_BINS; ++b)
+            peak = st[s].hist[b] > peak ? st[s].hist[b] : peak;
+        for (uint32_t b = 0; b <= IRQ_HIST_BINS; ++b) // log scale so rare tail bins stay visible
+            line[b] = st[s].hist[b] ? shade[1 + (int)(8.0 * log1p((double)st[s].hist[b]) / log1p((double)peak))] : ' ';
+        line[IRQ_HIST_BINS + 1] = '\0';
+        printf("  %-12s |%s|\n", irq_srcs[s].name, line);
+    }
+    printf("capture ISRs: %s (limit %.1f us, no lost edges)\n", ok ? "within limit" : "LIMIT EXCEEDED",
+           IRQ_CAPTURE_LIMIT_NS / 1000.0);
+    return ok ? 0 : 1;
+}
+
+/* =========================
+   Zero-allocation check (./reflex allocguard)
+   ========================= */
+#define ALLOCGUARD_WARMUP_ROUNDS 6
+#define ALLOCGUARD_ROUNDS 5000
+
+// Returns 0 when steady-state rounds (incl. REPORT path) never touch the heap
+int allocguard_run(void)
+{
+    if (!ALLOC_GUARD_ACTIVE)
+    {
+        printf("allocguard: malloc interposition not built (use -DREFLEX_ALLOC_GUARD on glibc)\n");
+        return 1;
+    }
+
+    srand(443);
+    g_quiet = true;
+    // warm-up: first-use allocations (stdio buffers etc.) are allowed here
+    for (uint32_t i = 0; i < ALLOCGUARD_WARMUP_ROUNDS; ++i)
+    {
+        g_round_ix = 1 + i % 6;
+        run_one_round();
+    }
+
+    g_alloc_violations = 0;
+    for (uint32_t i = 0; i < ALLOCGUARD_ROUNDS; ++i)
+    {
+        g_round_ix = 1 + i % 6;
+        g_alloc_armed = true;
+        run_one_round();
+        g_alloc_armed = false;
+    }
+    g_quiet = false;
+
+    uint32_t v = g_alloc_violations;
+    printf("allocguard: %u steady-state rounds, %u heap calls\n", ALLOCGUARD_ROUNDS, v);
+    printf("allocguard: %s\n", v ? "FAIL (allocation in steady state)" : "ok");
+    return v ? 1 : 0;
+}
+
+/* =========================
+   Benchmarks (./reflex bench [name])
+   ========================= */
+#define BENCH_ROUNDS 20000
+
+static double bench_seconds(clock_t c0)
+{
+    return (double)(clock() - c0) / (double)CLOCKS_PER_SEC;
+}
+
+// Full mock rounds, quiet; prints the hot-path instrumentation summary
+static void bench_rounds(void)
+{
+    srand(443);
+    g_quiet = true;
+    prof_reset();
+    const char *perf = prof_perf_init();
+    if (perf)
+        printf("perf_event: cache-miss / branch-miss counters enabled (%s)\n", perf);
+#ifdef REFLEX_PROF_PERF
+    else
+        printf("perf_event: unavailable, cache/branch columns stay 0\n");
+#endif
+    clock_t c0 = clock();
+    for (uint32_t i = 0; i < BENCH_ROUNDS; ++i)
+    {
+        g_round_ix = 1 + i % 6;
+        run_one_round();
+    }
+    double sec = bench_seconds(c0);
+    g_quiet = false;
+    printf("rounds: %u in %.3f s (%.0f rounds/s)\n", BENCH_ROUNDS, sec, sec > 0 ? BENCH_ROUNDS / sec : 0.0);
+    prof_dump();
+}
+
+#define BENCH_HISTORY_ROUNDS 10000000u
+#define BENCH_SOA_BATCH 4096u
+
+// Packed append + bulk SoA unpack throughput over the whole ring
+static void bench_history(void)
+{
+    static uint16_t wait[BENCH_SOA_BATCH], vis[BENCH_SOA_BATCH], tact[BENCH_SOA_BATCH];
+    static uint8_t cause[BENCH_SOA_BATCH], flags[BENCH_SOA_BATCH];
+    static uint32_t player[BENCH_SOA_BATCH];
+    const round_soa_t soa = {wait, vis, tact, cause, flags, player};
+    round_rec_t r;
+    memset(&r, 0, sizeof(r));
+
+    clock_t c0 = clock();
+    for (uint32_t i = 0; i < BENCH_HISTORY_ROUNDS; ++i)
+    {
+        r.wait_ms = RANDOM_WAIT_MIN_MS + i % 2001;
+        r.vis_ms = 150 + i % 700;
+        r.tact_ms = 120 + i % 500;
+        history_append(&g_history, round_pack(&r, i & PR_MASK(PR_PLAYER_BITS)));
+    }
+    double sec_app = bench_seconds(c0);
+
+    uint64_t sum = 0;
+    c0 = clock();
+    for (size_t first = 0; first < g_history.count; first += BENCH_SOA_BATCH)
+    {
+        size_t n = history_unpack_soa(&g_history, first, BENCH_SOA_BATCH, &soa);
+        for (size_t i = 0; i < n; ++i)
+            sum += (uint64_t)vis[i] + tact[i];
+    }
+    double sec_unp = bench_seconds(c0);
+
+    printf("append: %u rounds in %.3f s (%.1f M/s)\n", BENCH_HISTORY_ROUNDS, sec_app,
+           sec_app > 0 ? BENCH_HISTORY_ROUNDS / sec_app / 1e6 : 0.0);
+    printf("unpack: %zu rounds in %.3f s (%.1f M/s), checksum %llu\n", g_history.count, sec_unp,
+           sec_unp > 0 ? (double)g_history.count / sec_unp / 1e6 : 0.0, (unsigned long long)sum);
+    printf("memory: %zu B/round, %u-round ring = %.1f MiB (100M rounds = %.0f MiB)\n",
+           sizeof(packed_round_t), (unsigned)HISTORY_CAPACITY,
+           HISTORY_CAPACITY * sizeof(packed_round_t) / 1048576.0, 1e8 * sizeof(packed_round_t) / 1048576.0);
+}
+
+static int bench_u64_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+#define BENCH_REPORT_ROUNDS 200000u
+
+// REPORT-path cycles with the player's record evicted after session load, with/without IDLE prefetch
+static void bench_report(void)
+{
+    static const uint32_t row[1][2] = {{1350, 1530}};
+    static uint64_t cyc[2][BENCH_REPORT_ROUNDS];
+    uint32_t n[2] = {0, 0};
+    uint32_t x = 443;
+
+    g_quiet = true;
+    g_mock_data = row;
+    g_mock_rounds = 1;
+    g_round_ix = 1;
+    for (uint32_t i = 0; i < BENCH_REPORT_ROUNDS; ++i)
+    {
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5; // xorshift32 player id
+        uint32_t id = 1 + x % (PLAYER_STORE_CAPACITY - 1);
+        int pf = i & 1; // interleaved, so both arms see the same machine state
+        g_profile_prefetch = pf;
+        g_player_id = id;
+        g_active_profile = player_store_get(id);
+        g_best_total_ms = g_active_profile->best_ms;
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_clflush(g_active_profile); // other sessions ran since the profile was loaded
+        _mm_mfence();
+#endif
+        g_score_improved = false;
+        g_time = 0;
+        g_state = ST_IDLE;
+        player_store_prefetch(id);
+        g_state = ST_ARMED;
+        g_random_wait_ms = RANDOM_WAIT_MIN_MS;
+        if (!round_prewait_scan() || (g_state = ST_STIM_ON, !round_visual_scan()) || !round_tactile_scan())
+            continue;
+        uint64_t c0 = cycles_now();
+        round_report();
+        cyc[pf][n[pf]++] = cycles_now() - c0;
+    }
+    g_profile_prefetch = true;
+    g_player_id = 0;
+    g_active_profile = NULL;
+    g_best_total_ms = 0xFFFFFFFF;
+    g_mock_data = round_data;
+    g_mock_rounds = 6;
+    g_quiet = false;
+    printf("store: %u profiles (%.1f MiB)\n", (unsigned)PLAYER_STORE_CAPACITY,
+           sizeof(g_profiles) / 1048576.0);
+    uint64_t p50[2];
+    for (int pf = 0; pf < 2; ++pf)
+    {
+        qsort(cyc[pf], n[pf], sizeof(uint64_t), bench_u64_cmp);
+        p50[pf] = cyc[pf][n[pf] / 2];
+        printf("REPORT %-11s p50 %6llu cyc  p99 %8llu cyc\n", pf ? "prefetched:" : "cold:",
+               (unsigned long long)p50[pf], (unsigned long long)cyc[pf][n[pf] * 99 / 100]);
+    }
+    printf("saved: %lld cyc/round at p50 (the profile line's miss; the rest of REPORT is unaffected)\n",
+           (long long)p50[0] - (long long)p50[1]);
+}
+
+#define BENCH_ZIPF_KEYS (1u << 20)   // player id space
+#define BENCH_ZIPF_S 0.99
+#define BENCH_CACHE_LOOKUPS 400000u   // per run, split across threads
+#define BENCH_MAX_THREADS 32
+
+static uint32_t g_zipf_keys[BENCH_CACHE_LOOKUPS];
+
+// Pre-draw Zipf(s) ranks by CDF inversion; ranks are scattered over the id space
+static void zipf_fill(uint32_t *out, size_t n, uint32_t keys, double s, uint32_t seed)
+{
+    static double cdf[BENCH_ZIPF_KEYS];
+    double sum = 0.0;
+    for (uint32_t k = 0; k < keys; ++k)
+        cdf[k] = (sum += 1.0 / pow((double)(k + 1), s));
+    for (size_t i = 0; i < n; ++i)
+    {
+        seed ^= seed << 13, seed ^= seed >> 17, seed ^= seed << 5;
+        double u = (double)seed / 4294967296.0 * sum;
+        uint32_t lo = 0, hi = keys - 1;
+        while (lo < hi)
+        {
+            uint32_t mid = (lo + hi) / 2;
+            if (cdf[mid] < u)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        out[i] = 1 + (uint32_t)(((uint64_t)lo * 2654435761u) % (keys - 1));
+    }
+}
+
+typedef struct
+{
+    const uint32_t *keys;
+    size_t n;
+    uint64_t found;
+} bench_cache_arg_t;
+
+static void *bench_cache_worker(void *arg)
+{
+    bench_cache_arg_t *a = (bench_cache_arg_t *)arg;
+    uint32_t best, rounds;
+    for (size_t i = 0; i < a->n; ++i)
+        a->found += pcache_lookup(a->keys[i], &best, &rounds);
+    return NULL;
+}
+
+// Hub "best for player X" lookups/s through the player cache at 1..32 threads
+static void bench_cache(void)
+{
+    pthread_t th[BENCH_MAX_THREADS];
+    bench_cache_arg_t arg[BENCH_MAX_THREADS];
+
+    for (uint32_t id = 1; id < BENCH_ZIPF_KEYS; id += 7) // a sparse population with history
+    {
+        player_profile_t *p = player_store_get(id);
+        p->best_ms = 300 + id % 700;
+        p->rounds = 1 + id % 50;
+    }
+    zipf_fill(g_zipf_keys, BENCH_CACHE_LOOKUPS, BENCH_ZIPF_KEYS, BENCH_ZIPF_S, 443);
+    printf("zipf s=%.2f over %u ids, %u lookups/run, %u cached entries\n", BENCH_ZIPF_S,
+           BENCH_ZIPF_KEYS, BENCH_CACHE_LOOKUPS, PCACHE_SHARDS * PCACHE_SHARD_ENTRIES);
+    printf("%8s %14s %8s %10s\n", "threads", "lookups/s", "hit%", "evictions");
+    for (int nt = 1; nt <= BENCH_MAX_THREADS; nt *= 2)
+    {
+        pcache_reset();
+        size_t per = BENCH_CACHE_LOOKUPS / (size_t)nt;
+        double t0 = wall_now_s();
+        for (int i = 0; i < nt; ++i)
+        {
+            arg[i].keys = g_zipf_keys + (size_t)i * per;
+            arg[i].n = per;
+            arg[i].found = 0;
+            pthread_create(&th[i], NULL, bench_cache_worker, &arg[i]);
+        }
+        for (int i = 0; i < nt; ++i)
+            pthread_join(th[i], NULL);
+        double sec = wall_now_s() - t0;
+        pcache_stats_t st = pcache_stats();
+        uint64_t total = st.hits + st.misses;
+        printf("%8d %14.0f %7.1f%% %10llu\n", nt, sec > 0 ? (double)total / sec : 0.0,
+               total ? 100.0 * (double)st.hits / (double)total : 0.0, (unsigned long long)st.evictions);
+    }
+    memset(g_profiles, 0, sizeof(g_profiles));
+    pcache_reset();
+}
+
+#define BENCH_LB_OPS 400000u // per run, split across threads
+
+static pthread_mutex_t g_lb_global_lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct
+{
+    uint32_t seed;
+    size_t n;
+    bool global_lock; // mutex-protected baseline: every operation serialized
+    uint64_t checksum;
+} bench_lb_arg_t;
+
+// 75% submit, 20% rank, 5% top-10
+static void *bench_lb_worker(void *arg)
+{
+    bench_lb_arg_t *a = (bench_lb_arg_t *)arg;
+    uint32_t x = a->seed;
+    lb_entry_t top[10];
+    for (size_t i = 0; i < a->n; ++i)
+    {
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        uint32_t player = 1 + (x >> 8) % (BENCH_ZIPF_KEYS - 1);
+        uint32_t op = x & 0x3F;
+        if (a->global_lock)
+            pthread_mutex_lock(&g_lb_global_lock);
+        if (op < 48)
+            a->checksum += lb_submit(player, 200 + (x >> 4) % 1200, NULL);
+        else if (op < 61)
+            a->checksum += lb_rank(player);
+        else
+            a->checksum += lb_top_k(top, 10);
+        if (a->global_lock)
+            pthread_mutex_unlock(&g_lb_global_lock);
+    }
+    return NULL;
+}
+
+// Sharded leaderboard vs the same operations behind one global mutex, 1..32 threads
+static void bench_leaderboard(void)
+{
+    pthread_t th[BENCH_MAX_THREADS];
+    bench_lb_arg_t arg[BENCH_MAX_THREADS];
+
+    printf("%u ops/run (75%% submit, 20%% rank, 5%% top-10) over %u players\n", BENCH_LB_OPS, BENCH_ZIPF_KEYS);
+    printf("%8s %16s %16s\n", "threads", "sharded ops/s", "mutex ops/s");
+    for (int nt = 1; nt <= BENCH_MAX_THREADS; nt *= 2)
+    {
+        double ops_s[2];
+        for (int g = 0; g < 2; ++g)
+        {
+            lb_reset();
+            size_t per = BENCH_LB_OPS / (size_t)nt;
+            double t0 = wall_now_s();
+            for (int i = 0; i < nt; ++i)
+            {
+                arg[i].seed = 443u + 7919u * (uint32_t)i;
+                arg[i].n = per;
+                arg[i].global_lock = g;
+                arg[i].checksum = 0;
+                pthread_create(&th[i], NULL, bench_lb_worker, &arg[i]);
+            }
+            for (int i = 0; i < nt; ++i)
+                pthread_join(th[i], NULL);
+            double sec = wall_now_s() - t0;
+            ops_s[g] = sec > 0 ? (double)(per * (size_t)nt) / sec : 0.0;
+        }
+        printf("%8d %16.0f %16.0f\n", nt, ops_s[0], ops_s[1]);
+    }
+
+    lb_entry_t top[3];
+    uint32_t n = lb_top_k(top, 3);
+    for (uint32_t i = 0; i < n; ++i)
+        printf("  #%u player %u  %u ms (rank %u)\n", i + 1, top[i].player, top[i].total_ms, lb_rank(top[i].player));
+    lb_reset();
+}
+
+#define BENCH_PCT_UPDATES 20000000u
+
+// Histogram updates/s (population churn) and percentile lookups/s
+static void bench_percentile(void)
+{
+    static uint32_t best[BENCH_ZIPF_KEYS];
+    pct_hist_t *ph = &g_pct;
+    uint32_t x = 443;
+    uint64_t sum = 0;
+
+    memset(ph, 0, sizeof(*ph));
+    ph->dirty_block = PCT_BLOCKS;
+    memset(best, 0xFF, sizeof(best));
+    double t0 = wall_now_s();
+    for (uint32_t i = 0; i < BENCH_PCT_UPDATES; ++i)
+    {
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        uint32_t p = x % BENCH_ZIPF_KEYS;
+        uint32_t t = 150 + (x >> 20) % 1500;
+        if (t < best[p])
+        {
+            pct_move(ph, best[p], t);
+            best[p] = t;
+        }
+    }
+    double up = wall_now_s() - t0;
+
+    t0 = wall_now_s();
+    for (uint32_t i = 0; i < BENCH_PCT_UPDATES; ++i)
+        sum += pct_faster_than(ph, 150 + i % 1500);
+    double lk = wall_now_s() - t0;
+
+    pct_fold(ph);
+    printf("updates: %u in %.3f s (%.1f M/s), %u players\n", BENCH_PCT_UPDATES, up,
+           up > 0 ? BENCH_PCT_UPDATES / up / 1e6 : 0.0, ph->players);
+    printf("lookups: %u in %.3f s (%.1f M/s), checksum %llu\n", BENCH_PCT_UPDATES, lk,
+           lk > 0 ? BENCH_PCT_UPDATES / lk / 1e6 : 0.0, (unsigned long long)sum);
+    printf("160 ms is faster than %u%% of players; table %zu B\n", pct_faster_than(ph, 160), sizeof(*ph));
+    memset(ph, 0, sizeof(*ph));
+    ph->dirty_block = PCT_BLOCKS;
+}
+
+#define BENCH_JOURNAL_ROUNDS 300000u
+#define BENCH_JOURNAL_PLAYERS 1000u
+#define BENCH_JOURNAL_QUERIES 200u
+#define BENCH_JOURNAL_MAX_SEGS 64u // segment files swept by bench_journal_remove
+
+// Delete every file a bench journal can leave: active rows, index, manifest, sealed and compacted segments
+static void bench_journal_remove(const char *pfx)
+{
+    static const char *const fmt[] = {"%s.journal.%u", "%s.col.%u", "%s.col.%u.tmp"};
+    static const char *const one[] = {"%s.journal", "%s.journal.next", "%s.jidx", "%s.manifest", "%s.manifest.tmp"};
+    char path[96];
+    for (uint32_t k = 0; k < BENCH_JOURNAL_MAX_SEGS; ++k)
+        for (size_t f = 0; f < sizeof(fmt) / sizeof(fmt[0]); ++f)
+        {
+            snprintf(path, sizeof(path), fmt[f], pfx, k);
+            remove(path);
+        }
+    for (size_t f = 0; f < sizeof(one) / sizeof(one[0]); ++f)
+    {
+        snprintf(path, sizeof(path), one[f], pfx);
+        remove(path);
+    }
+}
+
+// Rows of one player in a row-format journal file (full scan)
+static size_t bench_journal_scan(const char *path, uint32_t player)
+{
+    FILE *f = fopen(path, "rb");
+    journal_rec_t buf[1024];
+    size_t n, hits = 0;
+    while (f && (n = fread(buf, sizeof(buf[0]), 1024, f)) > 0)
+        for (size_t i = 0; i < n; ++i)
+            hits += PR_FIELD(buf[i].packed, PLAYER) == player;
+    if (f)
+        fclose(f);
+    return hits;
+}
+
+// Append rate, then last-1000 / time-range queries via the index vs a full journal scan
+static void bench_journal(void)
+{
+    static journal_rec_t rows[HISTORY_QUERY_MAX];
+    journal_t *j = &g_journal;
+    round_rec_t r;
+    uint32_t x = 443;
+
+    bench_journal_remove("bench_tmp");
+    if (!journal_open(j, "bench_tmp"))
+    {
+        printf("cannot create bench_tmp journal\n");
+        return;
+    }
+    memset(&r, 0, sizeof(r));
+    double t0 = wall_now_s();
+    for (uint32_t i = 0; i < BENCH_JOURNAL_ROUNDS; ++i)
+    {
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        r.wait_ms = RANDOM_WAIT_MIN_MS + x % 2001;
+        r.vis_ms = 150 + (x >> 11) % 700;
+        r.tact_ms = 120 + (x >> 21) % 500;
+        uint32_t player = 1 + x % BENCH_JOURNAL_PLAYERS;
+        journal_append(j, i + 1, 1000000u + i / 10, player, round_pack(&r, player));
+    }
+    fflush(j->jf);
+    double app = wall_now_s() - t0;
+
+    size_t got = 0;
+    t0 = wall_now_s();
+    for (uint32_t q = 0; q < BENCH_JOURNAL_QUERIES; ++q)
+        got += journal_query(j, 1 + q * 7 % BENCH_JOURNAL_PLAYERS, 0, 0xFFFFFFFF, rows, HISTORY_QUERY_MAX);
+    double last = wall_now_s() - t0;
+
+    t0 = wall_now_s();
+    size_t got_range = 0;
+    for (uint32_t q = 0; q < BENCH_JOURNAL_QUERIES; ++q)
+        got_range += journal_query(j, 1 + q * 7 % BENCH_JOURNAL_PLAYERS, 1000000u + 5000, 1000000u + 6000,
+                                   rows, HISTORY_QUERY_MAX);
+    double range = wall_now_s() - t0;
+
+    // baseline: one full scan of every sealed segment and the active file for a single player's rows
+    char path[64];
+    size_t hits = 0;
+    t0 = wall_now_s();
+    for (uint32_t seg = 0; seg < atomic_load(&j->next_seg); ++seg)
+    {
+        snprintf(path, sizeof(path), "bench_tmp.journal.%u", seg);
+        hits += bench_journal_scan(path, 1);
+    }
+    hits += bench_journal_scan("bench_tmp.journal", 1);
+    hits += bench_journal_scan("bench_tmp.journal.next", 1); // rows after a seal no compactor has rotated
+    double scan = wall_now_s() - t0;
+
+    printf("append: %u rounds in %.3f s (%.0f rounds/s), %u index chunks\n", BENCH_JOURNAL_ROUNDS, app,
+           app > 0 ? BENCH_JOURNAL_ROUNDS / app : 0.0, j->nchunks);
+    printf("last-1000 query: %.1f us avg (%zu rows)\n", last * 1e6 / BENCH_JOURNAL_QUERIES, got);
+    printf("time-range query: %.1f us avg (%zu rows)\n", range * 1e6 / BENCH_JOURNAL_QUERIES, got_range);
+    printf("full-scan baseline: %.1f us for one player (%zu rows, %u sealed segments + active)\n", scan * 1e6, hits,
+           atomic_load(&j->next_seg));
+    journal_close(j);
+    bench_journal_remove("bench_tmp");
+}
+
+#define BENCH_COMPACT_ROWS (9u * JOURNAL_SEAL_ROWS + 1000u)
+
+// Append latency with and without the background compactor (seal appends shown apart), then compression ratio
+static void bench_compaction(void)
+{
+    static const char *const pfx = "bench_cmp";
+    static uint64_t cyc[BENCH_COMPACT_ROWS];
+    journal_t *j = &g_journal;
+    round_rec_t r;
+    memset(&r, 0, sizeof(r));
+
+    for (int with_bg = 0; with_bg < 2; ++with_bg)
+    {
+        char path[64];
+        bench_journal_remove(pfx);
+        if (!journal_open(j, pfx))
+        {
+            printf("cannot create %s journal\n", pfx);
+            return;
+        }
+
+        compactor_t cp = {j, false, 0, 0, 0};
+        pthread_t th;
+        if (with_bg)
+            pthread_create(&th, NULL, compactor_main, &cp);
+
+        uint64_t seal_worst = 0, sum = 0;
+        uint32_t x = 443;
+        for (uint32_t i = 0; i < BENCH_COMPACT_ROWS; ++i)
+        {
+            x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+            r.wait_ms = RANDOM_WAIT_MIN_MS + x % 2001;
+            r.vis_ms = 150 + (x >> 11) % 700;
+            r.tact_ms = 120 + (x >> 21) % 500;
+            uint32_t player = 1 + x % 5000;
+            atomic_fetch_add(&g_fg_busy, 1);
+            uint64_t c0 = cycles_now();
+            journal_append(j, i + 1, 1000000u + i / 10, player, round_pack(&r, player));
+            uint64_t dt = cycles_now() - c0;
+            atomic_fetch_sub(&g_fg_busy, 1);
+            sum += dt;
+            cyc[i] = dt;
+            if (j->active_rows == 0 && dt > seal_worst)
+                seal_worst = dt;
+        }
+        qsort(cyc, BENCH_COMPACT_ROWS, sizeof(cyc[0]), bench_u64_cmp);
+        printf("%-15s append mean %6.0f  p50 %6llu  p99 %7llu  p99.9 %8llu  max %9llu cyc; seals max %9llu cyc\n",
+               with_bg ? "with compactor" : "no compactor", (double)sum / BENCH_COMPACT_ROWS,
+               (unsigned long long)cyc[BENCH_COMPACT_ROWS / 2], (unsigned long long)cyc[BENCH_COMPACT_ROWS / 100 * 99],
+               (unsigned long long)cyc[BENCH_COMPACT_ROWS / 1000 * 999], (unsigned long long)cyc[BENCH_COMPACT_ROWS - 1],
+               (unsigned long long)seal_worst);
+
+        if (!with_bg)
+            pthread_create(&th, NULL, compactor_main, &cp);
+        atomic_store(&cp.stop, true);
+        pthread_join(th, NULL);
+        if (with_bg)
+        {
+            colseg_hdr_t h;
+            static uint32_t col[JOURNAL_SEAL_ROWS];
+            snprintf(path, sizeof(path), "%s.col.0", pfx);
+            bool ok = colseg_read_column(path, COL_TS, &h, col, g_compact_words);
+            printf("compacted %u segments: %.1f MiB rows → %.1f MiB columnar (%.1fx); seg 0 ts zone [%u, %u] %s\n",
+                   cp.segments, cp.bytes_in / 1048576.0, cp.bytes_out / 1048576.0,
+                   cp.bytes_out ? (double)cp.bytes_in / (double)cp.bytes_out : 0.0, h.min[COL_TS], h.max[COL_TS],
+                   ok && col[h.rows - 1] == h.max[COL_TS] ? "ok" : "DECODE MISMATCH");
+        }
+        journal_close(j);
+    }
+    bench_journal_remove(pfx);
+}
+
+#define BENCH_DEDUPE_FRAMES 20000000u
+#define BENCH_RESEND_ROUNDS 200000u
+
+// Dedupe cost at full ingest rate over a lossy/duplicating link, then gap repair via the journal
+static void bench_dedupe(void)
+{
+    uint32_t x = 443, seq[HUB_MAX_STATIONS] = {0};
+    uint64_t accepted = 0;
+
+    hub_reset();
+    double t0 = wall_now_s();
+    for (uint32_t i = 0; i < BENCH_DEDUPE_FRAMES; ++i)
+    {
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        uint16_t stn = (uint16_t)(x % 64);
+        uint32_t s = ++seq[stn];
+        if ((x >> 8) % 100 == 0 && s > 32)
+            s -= 1 + (x >> 16) % 32; // retransmission of a recent frame
+        accepted += hub_seq_check(stn, s) == HUB_ACCEPT;
+    }
+    double sec = wall_now_s() - t0;
+    printf("dedupe: %u frames from 64 stations in %.3f s (%.1f M frames/s, %.1f ns/frame), %llu accepted\n",
+           BENCH_DEDUPE_FRAMES, sec, sec > 0 ? BENCH_DEDUPE_FRAMES / sec / 1e6 : 0.0,
+           sec * 1e9 / BENCH_DEDUPE_FRAMES, (unsigned long long)accepted);
+
+    // lossy link: 1% lost, 1% duplicated; gaps are repaired from the station journal
+    journal_t *j = &g_journal;
+    bench_journal_remove("bench_dd");
+    if (!journal_open(j, "bench_dd"))
+        return;
+    hub_reset();
+    lb_reset();
+    round_rec_t r;
+    memset(&r, 0, sizeof(r));
+    uint64_t delivered = 0;
+    size_t resent = 0;
+    for (uint32_t s = 1; s <= BENCH_RESEND_ROUNDS; ++s)
+    {
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        r.vis_ms = 150 + x % 700;
+        r.tact_ms = 120 + (x >> 10) % 500;
+        hub_frame_t f = {STATION_ID, s, round_pack(&r, 1 + (x >> 20) % 1000)};
+        journal_append(j, s, 1000000u + s, PR_FIELD(f.packed, PLAYER), f.packed); // ids < 2^24 here
+        if (x % 100 == 0)
+            continue; // lost on the wire
+        delivered += hub_ingest(&f);
+        if (x % 100 == 1)
+            delivered += hub_ingest(&f); // duplicate (must be dropped)
+        if (s % HUB_RESEND_EVERY == 0)
+            resent += hub_resend_gaps(STATION_ID, j);
+    }
+    hub_station_t *st = &g_hub[STATION_ID];
+    uint64_t gaps = st->gap_frames;
+    resent += hub_resend_gaps(STATION_ID, j);
+    printf("link: %u rounds, %llu missing seqs detected, %zu rows resent, %llu dups dropped, accepted %llu (%s)\n",
+           BENCH_RESEND_ROUNDS, (unsigned long long)gaps, resent, (unsigned long long)st->dups,
+           (unsigned long long)st->accepted, st->accepted == BENCH_RESEND_ROUNDS ? "exactly once" : "MISMATCH");
+    journal_close(j);
+    bench_journal_remove("bench_dd");
+    hub_reset();
+    lb_reset();
+    (void)delivered;
+}
+
+#define BENCH_MPSC_RECORDS 2000000u // per run, split across producers
+#define LAT_BUCKETS 40                // log2(cycles) latency histogram
+
+static mpsc_queue_t g_ingest_q;
+
+typedef struct
+{
+    uint16_t station;
+    size_t n;
+} bench_mpsc_arg_t;
+
+// Reader thread: one station connection producing parsed frames
+static void *bench_mpsc_producer(void *arg)
+{
+    bench_mpsc_arg_t *a = (bench_mpsc_arg_t *)arg;
+    uint32_t x = 443u + a->station;
+    for (size_t i = 0; i < a->n; ++i)
+    {
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        round_rec_t r;
+        memset(&r, 0, sizeof(r));
+        r.vis_ms = 150 + x % 700;
+        r.tact_ms = 120 + (x >> 10) % 500;
+        hub_frame_t f = {a->station, (uint32_t)i + 1, round_pack(&r, 1 + (x >> 12) % 100000)};
+        while (!mpsc_push(&g_ingest_q, &f))
+            sched_yield(); // full: aggregator is behind
+    }
+    return NULL;
+}
+
+// Single aggregator draining the queue in batches; p50/p99/p99.9 enqueue→dequeue latency
+static void bench_mpsc(void)
+{
+    pthread_t th[BENCH_MAX_THREADS];
+    bench_mpsc_arg_t arg[BENCH_MAX_THREADS];
+    hub_frame_t batch[MPSC_BATCH];
+    uint64_t t_enq[MPSC_BATCH];
+    double cpn = cycles_per_ns();
+
+    printf("%u records/run, %d-slot queue, batch %d\n", BENCH_MPSC_RECORDS, MPSC_CAPACITY, MPSC_BATCH);
+    printf("%9s %14s %10s %10s %10s\n", "producers", "records/s", "p50 ns", "p99 ns", "p99.9 ns");
+    for (int np = 1; np <= BENCH_MAX_THREADS; np *= 2)
+    {
+        uint64_t hist[LAT_BUCKETS] = {0};
+        size_t per = BENCH_MPSC_RECORDS / (size_t)np, total = per * (size_t)np, got = 0;
+        mpsc_init(&g_ingest_q);
+        hub_reset();
+        lb_reset();
+        double t0 = wall_now_s();
+        for (int i = 0; i < np; ++i)
+        {
+            arg[i].station = (uint16_t)(i + 1);
+            arg[i].n = per;
+            pthread_create(&th[i], NULL, bench_mpsc_producer, &arg[i]);
+        }
+        while (got < total)
+        {
+            size_t n = mpsc_pop_batch(&g_ingest_q, batch, t_enq, MPSC_BATCH);
+            if (n == 0)
+            {
+                sched_yield();
+                continue;
+            }
+            uint64_t now = cycles_now();
+            atomic_fetch_add_explicit(&g_fg_busy, 1, memory_order_relaxed);
+            for (size_t i = 0; i < n; ++i)
+            {
+                hub_ingest(&batch[i]);
+                uint64_t d = now > t_enq[i] ? now - t_enq[i] : 1;
+                hist[63 - __builtin_clzll(d | 1)]++;
+            }
+            atomic_fetch_sub_explicit(&g_fg_busy, 1, memory_order_relaxed);
+            got += n;
+        }
+        double sec = wall_now_s() - t0;
+        for (int i = 0; i < np; ++i)
+            pthread_join(th[i], NULL);
+
+        double q[3] = {0.5, 0.99, 0.999}, ns[3] = {0, 0, 0};
+        for (int k = 0; k < 3; ++k)
+        {
+            uint64_t cum = 0;
+            for (int b = 0; b < LAT_BUCKETS; ++b)
+                if ((cum += hist[b]) >= (uint64_t)(q[k] * (double)total))
+                {
+                    ns[k] = (double)(2ull << b) / cpn; // bucket upper bound
+                    break;
+                }
+        }
+        printf("%9d %14.0f %10.0f %10.0f %10.0f\n", np, sec > 0 ? (double)total / sec : 0.0, ns[0], ns[1], ns[2]);
+    }
+    hub_reset();
+    lb_reset();
+}
+
+#define BENCH_STATS_UPDATES 1000000u // per thread
+
+typedef struct
+{
+    uint32_t tid, mode;
+} bench_stats_arg_t;
+
+// Every mode updates the counters stats_round does (rounds, bests, best, sum, sumsq, histogram bin):
+// 0: one shared atomic set; 1: per-thread words interleaved field by field (false sharing); 2: sharded g_stats
+static struct
+{
+    _Atomic uint64_t rounds, bests, sum, sumsq;
+    _Atomic uint32_t best_ms;
+    _Atomic uint32_t hist[STATS_HIST_BINS];
+} g_bench_shared;
+
+static struct
+{
+    uint64_t rounds[BENCH_MAX_THREADS], bests[BENCH_MAX_THREADS], sum[BENCH_MAX_THREADS], sumsq[BENCH_MAX_THREADS];
+    uint32_t best_ms[BENCH_MAX_THREADS];
+    uint32_t hist[STATS_HIST_BINS][BENCH_MAX_THREADS];
+} g_bench_packed;
+
+static void *bench_stats_worker(void *arg)
+{
+    bench_stats_arg_t *a = (bench_stats_arg_t *)arg;
+    uint32_t x = 443u + a->tid, t = a->tid;
+    for (uint32_t i = 0; i < BENCH_STATS_UPDATES; ++i)
+    {
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        uint32_t total = 300 + x % 1500, bin = total / STATS_HIST_BIN_MS;
+        bin = bin < STATS_HIST_BINS ? bin : STATS_HIST_BINS - 1;
+        if (a->mode == 0)
+        {
+            atomic_fetch_add_explicit(&g_bench_shared.rounds, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&g_bench_shared.bests, 0, memory_order_relaxed);
+            uint32_t b = atomic_load_explicit(&g_bench_shared.best_ms, memory_order_relaxed);
+            while (total < b && !atomic_compare_exchange_weak_explicit(&g_bench_shared.best_ms, &b, total,
+                                                                      memory_order_relaxed, memory_order_relaxed))
+                ;
+            atomic_fetch_add_explicit(&g_bench_shared.sum, total, memory_order_relaxed);
+            atomic_fetch_add_explicit(&g_bench_shared.sumsq, (uint64_t)total * total, memory_order_relaxed);
+            atomic_fetch_add_explicit(&g_bench_shared.hist[bin], 1, memory_order_relaxed);
+        }
+        else if (a->mode == 1)
+        {
+            (*(volatile uint64_t *)&g_bench_packed.rounds[t])++;
+            (*(volatile uint64_t *)&g_bench_packed.bests[t]) += 0;
+            if (total < *(volatile uint32_t *)&g_bench_packed.best_ms[t])
+                *(volatile uint32_t *)&g_bench_packed.best_ms[t] = total;
+            (*(volatile uint64_t *)&g_bench_packed.sum[t]) += total;
+            (*(volatile uint64_t *)&g_bench_packed.sumsq[t]) += (uint64_t)total * total;
+            (*(volatile uint32_t *)&g_bench_packed.hist[bin][t])++;
+        }
+        else
+            stats_round(&g_stats, total, false);
+    }
+    return NULL;
+}
+
+// Shared vs falsely-shared vs per-core-sharded counters; checks the merged view against a serial reference
+static void bench_stats(void)
+{
+    static const char *modes[3] = {"shared", "packed", "sharded"};
+    pthread_t th[BENCH_MAX_THREADS];
+    bench_stats_arg_t arg[BENCH_MAX_THREADS];
+
+    // Serial reference: the single-threaded counter semantics every mode must reproduce
+    uint64_t ref_n = 0;
+    uint32_t ref_best = 0xFFFFFFFF;
+    double ref_sum = 0.0;
+    for (uint32_t t = 0; t < BENCH_MAX_THREADS; ++t)
+    {
+        uint32_t x = 443u + t;
+        for (uint32_t i = 0; i < BENCH_STATS_UPDATES; ++i)
+        {
+            x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+            uint32_t total = 300 + x % 1500;
+            ref_n++;
+            ref_sum += total;
+            if (total < ref_best)
+                ref_best = total;
+        }
+    }
+
+    printf("%u updates/thread (Mupd/s)\n", BENCH_STATS_UPDATES);
+    printf("%7s %10s %10s %10s\n", "threads", modes[0], modes[1], modes[2]);
+    stats_view_t v;
+    for (uint32_t nt = 1; nt <= BENCH_MAX_THREADS; nt *= 2)
+    {
+        double mups[3];
+        for (uint32_t m = 0; m < 3; ++m)
+        {
+            memset(&g_bench_shared, 0, sizeof(g_bench_shared));
+            atomic_store(&g_bench_shared.best_ms, 0xFFFFFFFF);
+            memset(&g_bench_packed, 0, sizeof(g_bench_packed));
+            memset(g_bench_packed.best_ms, 0xFF, sizeof(g_bench_packed.best_ms));
+            stats_reset(&g_stats);
+            double t0 = wall_now_s();
+            for (uint32_t i = 0; i < nt; ++i)
+            {
+                arg[i] = (bench_stats_arg_t){i, m};
+                pthread_create(&th[i], NULL, bench_stats_worker, &arg[i]);
+            }
+            for (uint32_t i = 0; i < nt; ++i)
+                pthread_join(th[i], NULL);
+            double sec = wall_now_s() - t0;
+            mups[m] = sec > 0 ? (double)nt * BENCH_STATS_UPDATES / sec / 1e6 : 0.0;
+        }
+        printf("%7u %10.1f %10.1f %10.1f\n", nt, mups[0], mups[1], mups[2]);
+    }
+    // last run was sharded at BENCH_MAX_THREADS: merged view must equal the serial reference
+    stats_read(&g_stats, &v);
+    printf("merged: %llu rounds, best %u ms, mean %.3f ms (reference %llu, %u, %.3f) %s\n",
+           (unsigned long long)v.rounds, v.best_ms, v.mean, (unsigned long long)ref_n, ref_best, ref_sum / ref_n,
+           v.rounds == ref_n && v.best_ms == ref_best && fabs(v.mean - ref_sum / ref_n) < 1e-6 ? "ok" : "MISMATCH");
+    stats_reset(&g_stats);
+}
+
+#define BENCH_HAL_SCANS 20000u // visual windows scanned per variant
+
+// One scan loop, instantiated per dispatch style (the C stand-in for a template parameter)
+#define BENCH_HAL_SCAN(name, VISUAL)                                          \
+    static uint32_t name(uint32_t t_end)                                      \
+    {                                                                         \
+        for (uint32_t t = 0; t < t_end; ++t)                                  \
+            if (VISUAL(t))                                                    \
+                return t;                                                     \
+        return t_end;                                                         \
+    }
+
+typedef struct
+{
+    int (*visual)(uint32_t t);
+} hal_vtable_t;
+
+static int hal_mock_visual_fn(uint32_t t)
+{
+    return hal_mock_visual(t);
+}
+static const hal_vtable_t g_hal_mock_vtable = {hal_mock_visual_fn};
+static const hal_vtable_t *volatile g_bench_hal_vt = &g_hal_mock_vtable; // opaque to the optimizer
+
+#define BENCH_VIS_DIRECT(t) visual_sensor_output(t)
+#define BENCH_VIS_STATIC(t) HAL_CAT(hal_, mock, _visual)(t)
+#define BENCH_VIS_VTABLE(t) vt->visual(t)
+
+BENCH_HAL_SCAN(bench_scan_direct, BENCH_VIS_DIRECT)
+BENCH_HAL_SCAN(bench_scan_static, BENCH_VIS_STATIC)
+
+static uint32_t bench_scan_vtable(uint32_t t_end)
+{
+    const hal_vtable_t *vt = g_bench_hal_vt;
+    for (uint32_t t = 0; t < t_end; ++t)
+        if (BENCH_VIS_VTABLE(t))
+            return t;
+    return t_end;
+}
+
+// Static-dispatch HAL vs hand-written direct calls vs a function-pointer table (ns per sensor poll)
+static void bench_hal(void)
+{
+    static const struct
+    {
+        const char *name;
+        uint32_t (*scan)(uint32_t t_end);
+    } variants[] = {{"direct", bench_scan_direct}, {"HAL static", bench_scan_static}, {"vtable", bench_scan_vtable}};
+    uint32_t saved_ix = g_round_ix;
+    uint64_t polls = 0;
+    printf("backend in this build: %s\n", HAL_IS(mock) ? "mock" : HAL_IS(replay) ? "replay" : HAL_IS(sim) ? "sim" : "term");
+    for (uint32_t v = 0; v < sizeof(variants) / sizeof(variants[0]); ++v)
+    {
+        volatile uint32_t sink = 0;
+        uint64_t best = UINT64_MAX;
+        for (uint32_t rep = 0; rep < 3; ++rep) // best of 3 (first pass also warms caches/predictors)
+        {
+            polls = 0;
+            uint64_t c0 = cycles_now();
+            for (uint32_t i = 0; i < BENCH_HAL_SCANS; ++i)
+            {
+                g_round_ix = 1 + i % g_mock_rounds; // edge positions vary with the mock table row
+                uint32_t hit = variants[v].scan(RANDOM_WAIT_MAX_MS + VISUAL_WINDOW_MS);
+                sink += hit;
+                polls += hit + 1;
+            }
+            uint64_t c = cycles_now() - c0;
+            if (c < best)
+                best = c;
+        }
+        double ns = (double)best / cycles_per_ns() / (double)polls;
+        printf("%-11s %6.2f ns/poll  (%llu polls)\n", variants[v].name, ns, (unsigned long long)polls);
+        (void)sink;
+    }
+    g_round_ix = saved_ix;
+}
+
+#define BENCH_ECHO_SAMPLES 20000u // 50 ms receive window at ECHO_FS_HZ
+#define BENCH_ECHO_REPS 50u
+#define BENCH_ECHO_DELAY 12345u   // true echo position (samples)
+#define BENCH_ECHO_TRIALS 32u     // noise draws (and delay phases) behind the RMS arrival error
+
+static float g_echo_x[BENCH_ECHO_SAMPLES], g_echo_y[BENCH_ECHO_SAMPLES], g_echo_ref[BENCH_ECHO_SAMPLES];
+static echo_detector_t g_echo_det;
+
+// sigma 0.5 Gaussian noise plus the transmitted burst at sample `delay`
+static void bench_echo_signal(uint32_t seed, const float *ti, uint32_t m, uint32_t delay)
+{
+    uint32_t x = seed;
+    for (uint32_t i = 0; i < BENCH_ECHO_SAMPLES; i += 2) // Box-Muller pairs
+    {
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        double u1 = (x + 1.0) / 4294967297.0;
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        double u2 = x / 4294967296.0, r = sqrt(-2.0 * log(u1));
+        g_echo_x[i] = (float)(0.5 * r * cos(2.0 * M_PI * u2));
+        g_echo_x[i + 1] = (float)(0.5 * r * sin(2.0 * M_PI * u2));
+    }
+    for (uint32_t k = 0; k < m && delay + k < BENCH_ECHO_SAMPLES; ++k)
+        g_echo_x[delay + k] += ti[k];
+}
+
+// Matched filter throughput (MS/s, × real time at ECHO_FS_HZ) and RMS arrival error under noise, direct vs FFT
+static void bench_echo(void)
+{
+    static const uint32_t cycles[] = {8, 16, 32, 64, 100};
+    float ti[ECHO_MAX_TAPS], tq[ECHO_MAX_TAPS];
+    printf("%u samples @ %u kS/s, burst %u kHz, noise sigma 0.5, echo amplitude 1\n", BENCH_ECHO_SAMPLES,
+           ECHO_FS_HZ / 1000, ECHO_BURST_HZ / 1000);
+    printf("%6s %5s %6s %10s %10s %10s %6s %12s\n", "cycles", "taps", "path", "MS/s", "x realtime", "rms err us",
+           "missed", "fft-direct");
+    for (uint32_t c = 0; c < sizeof(cycles) / sizeof(cycles[0]); ++c)
+    {
+        uint32_t m = echo_burst_template(ti, tq, cycles[c]);
+        echo_init(&g_echo_det, ti, tq, m);
+        bench_echo_signal(443u, ti, m, BENCH_ECHO_DELAY);
+
+        bool q = g_quiet;
+        g_quiet = true;
+        double t0 = wall_now_s();
+        for (uint32_t r = 0; r < BENCH_ECHO_REPS; ++r)
+            pi2_echo_arrival_us(&g_echo_det, g_echo_x, BENCH_ECHO_SAMPLES, g_echo_y);
+        double sec = wall_now_s() - t0;
+
+        // FFT path must agree with the direct form (relative to the correlation peak)
+        float diff = 0.0f, peak = 1e-12f;
+        if (g_echo_det.use_fft)
+        {
+            uint32_t nout = BENCH_ECHO_SAMPLES - m + 1;
+            echo_direct(g_echo_x, nout, ti, tq, m, g_echo_ref);
+            for (uint32_t i = 0; i < nout; ++i)
+            {
+                diff = fmaxf(diff, fabsf(g_echo_y[i] - g_echo_ref[i]));
+                peak = fmaxf(peak, fabsf(g_echo_ref[i]));
+            }
+        }
+
+        // arrival error over fresh noise and every delay phase within a burst cycle (misses counted apart)
+        double se = 0.0;
+        uint32_t hits = 0;
+        for (uint32_t t = 0; t < BENCH_ECHO_TRIALS; ++t)
+        {
+            uint32_t delay = BENCH_ECHO_DELAY + t % (ECHO_FS_HZ / ECHO_BURST_HZ);
+            bench_echo_signal(443u + t * 7919u, ti, m, delay);
+            uint32_t us = pi2_echo_arrival_us(&g_echo_det, g_echo_x, BENCH_ECHO_SAMPLES, g_echo_y);
+            if (!us)
+                continue;
+            double err = (double)us - delay * 1e6 / ECHO_FS_HZ;
+            se += err * err;
+            hits++;
+        }
+        g_quiet = q;
+        double msps = sec > 0 ? (double)BENCH_ECHO_SAMPLES * BENCH_ECHO_REPS / sec / 1e6 : 0.0;
+        char agree[16] = "-";
+        if (g_echo_det.use_fft)
+            snprintf(agree, sizeof(agree), "%.2g", diff / peak);
+        printf("%6u %5u %6s %10.1f %10.1f %10.1f %3u/%-2u %12s\n", cycles[c], m, g_echo_det.use_fft ? "fft" : "direct",
+               msps, msps * 1e6 / ECHO_FS_HZ, hits ? sqrt(se / hits) : NAN, BENCH_ECHO_TRIALS - hits,
+               BENCH_ECHO_TRIALS, agree);
+    }
+}
+
+#define BENCH_WAVE_STARTS 100000u
+
+// Stimulus start cost/jitter (descriptor write vs the old synchronous printf) and the feedback timeline
+static void bench_wave(void)
+{
+    static uint64_t cyc[BENCH_WAVE_STARTS];
+    FILE *devnull = fopen("/dev/null", "w");
+    for (int v = 0; v < 2; ++v)
+    {
+        for (uint32_t i = 0; i < BENCH_WAVE_STARTS; ++i)
+        {
+            uint64_t c0 = cycles_now();
+            if (v == 0)
+                wave_fire(wave_stim, timer_now_ms());
+            else if (devnull)
+                fprintf(devnull, "[PI1] STIM_ON: LED=GREEN, vibration=short buzz\n"), fflush(devnull);
+            cyc[i] = cycles_now() - c0;
+        }
+        qsort(cyc, BENCH_WAVE_STARTS, sizeof(cyc[0]), bench_u64_cmp);
+        printf("%-18s start cycles p50 %6llu  p99 %6llu  max %8llu\n", v == 0 ? "OC/DMA descriptor" : "printf (old)",
+               (unsigned long long)cyc[BENCH_WAVE_STARTS / 2], (unsigned long long)cyc[BENCH_WAVE_STARTS * 99 / 100],
+               (unsigned long long)cyc[BENCH_WAVE_STARTS - 1]);
+    }
+    if (devnull)
+        fclose(devnull);
+
+    // FEEDBACK at REPORT, then the next round starts: the animation keeps playing with no CPU work
+    static const char *names[WAVE_CHANNELS] = {"LED", "vibe", "buzzer"};
+    uint64_t saved[WAVE_CHANNELS];
+    memcpy(saved, g_wave_reg, sizeof(saved));
+    char line[WAVE_CHANNELS][61];
+    uint32_t t0 = timer_now_ms();
+    wave_fire(wave_stim, t0);
+    for (uint32_t k = 0; k < 60; ++k)
+    {
+        if (k == 20)
+            wave_fire(wave_feedback, t0 + 400);
+        for (uint32_t c = 0; c < WAVE_CHANNELS; ++c)
+            line[c][k] = wave_level((wave_chan_t)c, t0 + k * 20 + 10) ? '#' : '.';
+    }
+    printf("timeline from STIM_ON (20 ms/char, FEEDBACK at +400 ms):\n");
+    for (uint32_t c = 0; c < WAVE_CHANNELS; ++c)
+    {
+        line[c][60] = '\0';
+        printf("  %-6s %s\n", names[c], line[c]);
+    }
+    memcpy(g_wave_reg, saved, sizeof(saved));
+}
+
+typedef struct
+{
+    const char *name;
+    void (*fn)(void);
+} bench_entry_t;
+
+static const bench_entry_t bench_table[] = {
+    {"rounds", bench_rounds},
+    {"history", bench_history},
+    {"report", bench_report},
+    {"cache", bench_cache},
+    {"leaderboard", bench_leaderboard},
+    {"percentile", bench_percentile},
+    {"journal", bench_journal},
+    {"compaction", bench_compaction},
+    {"dedupe", bench_dedupe},
+    {"mpsc", bench_mpsc},
+    {"stats", bench_stats},
+    {"hal", bench_hal},
+    {"echo", bench_echo},
+    {"wave", bench_wave},
+};
+
+// Run one named benchmark, or all of them when name is NULL
+int bench_run(const char *name)
+{
+    int ran = 0;
+    for (size_t i = 0; i < sizeof(bench_table) / sizeof(bench_table[0]); ++i)
+    {
+        if (name && strcmp(name, bench_table[i].name) != 0)
+            continue;
+        printf("=== bench: %s ===\n", bench_table[i].name);
+        bench_table[i].fn();
+        ran = 1;
+    }
+    if (!ran)
+    {
+        printf("unknown benchmark '%s'\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+/* =========================
+   C ABI (reflex.h; build with -DREFLEX_LIB -shared -fPIC)
+   ========================= */
+#define REFLEX_NEVER 0xFFFFFFFFu // input edge that never happens
+#define LIB_VIS_BIAS_MS 1u       // the engine times the visual reaction from the last foreperiod ms (wait - 1)
+
+struct reflex_session
+{
+    uint32_t player;
+    uint16_t threshold;
+    uint32_t best_ms;
+    uint32_t seq;
+    uint32_t round_ix;
+    // round in progress (REFLEX_EV_START .. decided)
+    bool armed;
+    uint32_t wait_ms;
+    uint32_t row[1][2]; // [visual_time, tactile_time] from ARMED, as in round_data
+    uint16_t pressure;
+};
+
+static __thread reflex_round_result_t *t_lib_out;
+
+// Library pipeline: the finished record becomes the caller's result row
+static void lib_result_stage(rec_handle_t h)
+{
+    const round_rec_t *r = rec_get(h);
+    reflex_round_result_t *o = t_lib_out;
+    o->seq = r->seq;
+    o->wait_ms = r->wait_ms;
+    o->vis_ms = r->vis_ms ? r->vis_ms - LIB_VIS_BIAS_MS : 0; // ms after STIM_ON
+    o->tact_ms = r->cause == ABORT_NONE ? r->tact_ms : 0;
+    o->total_ms = r->cause == ABORT_NONE ? r->total_ms - LIB_VIS_BIAS_MS : 0;
+    o->outcome = r->cause;
+    o->improved = (r->flags & REC_F_BEST_IMPROVED) != 0;
+    o->reserved = 0;
+    rec_release(h);
+}
+
+static const round_stage_fn lib_stages[] = {lib_result_stage};
+static pthread_once_t g_lib_once = PTHREAD_ONCE_INIT;
+
+static void lib_init(void)
+{
+    stats_reset(&g_stats);
+}
+
+// Run one round through the engine with the session's inputs; the engine's thread state is borrowed.
+// If the engine cannot record the round, out is zero-filled with REFLEX_ERROR and the session best is kept.
+static void lib_run_round(reflex_session_t *s, reflex_round_result_t *out)
+{
+    const round_stage_fn *stages = t_stages;
+    size_t nstages = t_nstages;
+    memset(out, 0, sizeof(*out));
+    out->outcome = REFLEX_ERROR; // overwritten by lib_result_stage once the round is published
+    t_stages = lib_stages;
+    t_nstages = 1;
+    t_lib_out = out;
+    g_mock_data = (const uint32_t(*)[2])s->row;
+    g_mock_rounds = 1;
+    g_mock_wait_ms = s->wait_ms;
+    g_mock_pressure = s->pressure;
+    g_player_id = s->player;
+    g_pressure_threshold = s->threshold;
+    g_best_total_ms = s->best_ms;
+    g_round_seq = s->seq;
+    g_active_profile = NULL;
+    g_round_ix = 1; // engine reads row[g_round_ix - 1]
+
+    run_one_round();
+
+    if (out->outcome != REFLEX_ERROR)
+    {
+        s->best_ms = g_best_total_ms;
+        s->seq = g_round_seq;
+        if (!s->wait_ms)
+            out->wait_ms = g_random_wait_ms;
+    }
+    out->round_ix = ++s->round_ix;
+    out->best_ms = s->best_ms == REFLEX_NEVER ? REFLEX_NEVER : s->best_ms - LIB_VIS_BIAS_MS;
+    g_mock_data = round_data;
+    g_mock_rounds = 6;
+    g_mock_wait_ms = 0;
+    g_mock_pressure = 0;
+    t_stages = stages;
+    t_nstages = nstages;
+    s->armed = false;
+}
+
+REFLEX_API uint32_t reflex_abi_version(void)
+{
+    return REFLEX_ABI_VERSION;
+}
+
+REFLEX_API reflex_session_t *reflex_session_create(uint32_t player, uint16_t pressure_threshold)
+{
+    pthread_once(&g_lib_once, lib_init);
+    reflex_session_t *s = (reflex_session_t *)calloc(1, sizeof(*s));
+    if (!s)
+        return NULL;
+    s->player = player;
+    s->threshold = pressure_threshold ? pressure_threshold : PRESSURE_THRESHOLD;
+    s->best_ms = REFLEX_NEVER;
+    return s;
+}
+
+REFLEX_API void reflex_session_destroy(reflex_session_t *s)
+{
+    free(s);
+}
+
+// Events only buffer the round's edges; the engine runs once the outcome is decided
+REFLEX_API size_t reflex_session_step(reflex_session_t *s, const reflex_event_t *ev, size_t n,
+                                      reflex_round_result_t *out, size_t max_out)
+{
+    size_t k = 0;
+    for (size_t i = 0; i < n && k < max_out; ++i)
+    {
+        const reflex_event_t *e = &ev[i];
+        if (e->type == REFLEX_EV_START)
+        {
+            s->armed = true;
+            s->wait_ms = e->arg;
+            s->row[0][0] = s->row[0][1] = REFLEX_NEVER;
+            s->pressure = 0;
+            continue;
+        }
+        if (!s->armed)
+            continue;
+        uint32_t vis_deadline = (s->wait_ms ? s->wait_ms : RANDOM_WAIT_MAX_MS) + VISUAL_WINDOW_MS;
+        bool decided = false;
+        if (e->type == REFLEX_EV_VISUAL && s->row[0][0] == REFLEX_NEVER)
+        {
+            s->row[0][0] = e->t_ms;
+            decided = (s->wait_ms && e->t_ms < s->wait_ms) || e->t_ms >= vis_deadline;
+        }
+        else if (e->type == REFLEX_EV_TACTILE && s->row[0][0] != REFLEX_NEVER)
+        {
+            s->row[0][1] = e->t_ms;
+            s->pressure = (uint16_t)(e->arg ? e->arg : 0);
+            decided = true;
+        }
+        else if (e->type == REFLEX_EV_TICK)
+        {
+            decided = s->row[0][0] == REFLEX_NEVER ? e->t_ms >= vis_deadline
+                                                  : e->t_ms >= s->row[0][0] + TACTILE_WINDOW_MS;
+        }
+        if (decided)
+            lib_run_round(s, &out[k++]);
+    }
+    return k;
+}
+
+REFLEX_API size_t reflex_eval_batch(const reflex_round_input_t *in, reflex_round_result_t *out, size_t n)
+{
+    reflex_session_t s;
+    pthread_once(&g_lib_once, lib_init);
+    memset(&s, 0, sizeof(s));
+    s.threshold = PRESSURE_THRESHOLD;
+    s.best_ms = REFLEX_NEVER;
+    for (size_t i = 0; i < n; ++i)
+    {
+        s.player = in[i].player;
+        s.wait_ms = in[i].wait_ms;
+        s.row[0][0] = in[i].vis_ms;
+        s.row[0][1] = in[i].tact_ms;
+        s.pressure = in[i].pressure;
+        lib_run_round(&s, &out[i]);
+    }
+    return n;
+}
+
+#ifndef REFLEX_LIB
+/* =========================
+   main()
+   ========================= */
+int main(int argc, char **argv)
+{
+    stats_reset(&g_stats);
+    if (argc > 1 && strcmp(argv[1], "wcet") == 0)
+        return wcet_run();
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return bench_run(argc > 2 ? argv[2] : NULL);
+    if (argc > 1 && strcmp(argv[1], "allocguard") == 0)
+        return allocguard_run();
+    if (argc > 1 && strcmp(argv[1], "duel") == 0)
+        return duel_run(argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 0,
+                        argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 10) : 0);
+    if (argc > 1 && strcmp(argv[1], "station") == 0)
+        return station_run(argc > 2 ? argv[2] : NULL);
+    if (argc > 1 && strcmp(argv[1], "sim") == 0)
+        return sim_run(argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : SIM_SESSIONS_DEFAULT,
+                       argc > 3 ? argv[3] : NULL);
+    if (argc > 1 && strcmp(argv[1], "soak") == 0)
+        return soak_run(argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : SOAK_DAYS_DEFAULT,
+                        argc > 3 ? argv[3] : NULL);
+    if (argc > 1 && strcmp(argv[1], "irq") == 0)
+        return irq_run(argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 10);
+    if (argc > 1 && strcmp(argv[1], "adc") == 0)
+        return adc_run(argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 100);
+    if (argc > 2 && strcmp(argv[1], "replay") == 0)
+        return replay_run(argv[2]);
+    if (argc > 3 && strcmp(argv[1], "history") == 0)
+        return history_run(argv[2], (uint32_t)strtoul(argv[3], NULL, 10),
+                           argc > 4 ? (size_t)strtoul(argv[4], NULL, 10) : 20);
+
     printf("=== Reflex Game Conceptual Design (Mock) ===\n");
 
     // Initialize random number generator
@@ -337,6 +6053,12 @@ int main(void)
         run_one_round();
     }
 
+    stats_view_t v;
+    stats_read(&g_stats, &v);
     printf("\nBest total so far = %u ms\n", g_best_total_ms);
+    printf("Rounds: %llu completed (mean %.0f ms, sd %.0f ms), %llu aborted, %llu visual glitches filtered\n",
+           (unsigned long long)v.rounds, v.mean, sqrt(v.var), (unsigned long long)(v.aborts[1] + v.aborts[2] + v.aborts[3]),
+           (unsigned long long)v.glitches);
     return 0;
 }
+#endif
@@ -0,0 +1,95 @@
+/* Reflex round engine — C ABI (build: see README, libreflex.so)
+ *
+ * ABI rules: structs only grow at the end, enum values are never renumbered,
+ * and reflex_abi_version() is bumped on any incompatible change.
+ * Sessions are not thread-safe; use one session per thread (the engine itself is).
+ */
+#ifndef REFLEX_H
+#define REFLEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(REFLEX_LIB) && defined(__GNUC__)
+#define REFLEX_API __attribute__((visibility("default")))
+#else
+#define REFLEX_API
+#endif
+
+#define REFLEX_ABI_VERSION 1u
+
+typedef struct reflex_session reflex_session_t; // opaque
+
+// Round outcome (matches the UART frame: completed, or aborted with a cause)
+typedef enum
+{
+    REFLEX_OK = 0,
+    REFLEX_FALSE_START = 1,  // hand seen during the foreperiod
+    REFLEX_VIS_TIMEOUT = 2,  // no hand within the visual window
+    REFLEX_TACT_TIMEOUT = 3, // no press within the tactile window
+    REFLEX_ERROR = 4         // engine could not record the round (row zeroed, session best unchanged)
+} reflex_outcome_t;
+
+// One round for batch evaluation; times in ms from ARMED (button press)
+typedef struct
+{
+    uint32_t player;    // 0 = anonymous
+    uint32_t wait_ms;   // foreperiod before STIM_ON (0 = engine's random 1–3 s)
+    uint32_t vis_ms;    // hand crosses the visual line (UINT32_MAX = never)
+    uint32_t tact_ms;   // press detected (UINT32_MAX = never)
+    uint16_t pressure;  // ADC value while pressing (0..1023; 0 = mock default)
+    uint16_t reserved;
+} reflex_round_input_t;
+
+typedef struct
+{
+    uint32_t seq;      // per-session round sequence
+    uint32_t round_ix; // 1-based round within the session
+    uint32_t wait_ms;
+    uint32_t vis_ms;   // reaction after STIM_ON (0 if aborted before)
+    uint32_t tact_ms;  // press after visual capture
+    uint32_t total_ms; // vis + tact (0 if aborted)
+    uint32_t best_ms;  // session best after this round (UINT32_MAX = none yet)
+    uint8_t outcome;   // reflex_outcome_t
+    uint8_t improved;  // 1 if this round set a new session best
+    uint16_t reserved;
+} reflex_round_result_t;
+
+// Input events for step-wise driving; t_ms is measured from ARMED
+typedef enum
+{
+    REFLEX_EV_START = 1,   // button: arms a round (arg = foreperiod ms, 0 = random)
+    REFLEX_EV_VISUAL = 2,  // visual line edge at t_ms
+    REFLEX_EV_TACTILE = 3, // press at t_ms (arg = ADC value, 0 = mock default)
+    REFLEX_EV_TICK = 4     // time has reached t_ms with no further edges
+} reflex_event_type_t;
+
+typedef struct
+{
+    uint32_t type; // reflex_event_type_t
+    uint32_t t_ms;
+    uint32_t arg;
+} reflex_event_t;
+
+REFLEX_API uint32_t reflex_abi_version(void);
+
+// player 0 = anonymous; pressure_threshold 0 = default calibration
+REFLEX_API reflex_session_t *reflex_session_create(uint32_t player, uint16_t pressure_threshold);
+REFLEX_API void reflex_session_destroy(reflex_session_t *s);
+
+// Feed events in time order; returns the number of results written to out (≤ max_out)
+REFLEX_API size_t reflex_session_step(reflex_session_t *s, const reflex_event_t *ev, size_t n,
+                                      reflex_round_result_t *out, size_t max_out);
+
+// Evaluate n independent rounds in one call (anonymous session per call; best is tracked across the batch)
+REFLEX_API size_t reflex_eval_batch(const reflex_round_input_t *in, reflex_round_result_t *out, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif